@@ -0,0 +1,15 @@
+/* contrib/amcheck/amcheck--1.2--1.3.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "ALTER EXTENSION amcheck UPDATE TO '1.3'" to load this file. \quit
+
+--
+-- verify_zedstore()
+--
+CREATE FUNCTION verify_zedstore(rel regclass)
+RETURNS VOID
+AS 'MODULE_PATHNAME', 'verify_zedstore'
+LANGUAGE C STRICT PARALLEL RESTRICTED;
+
+-- Don't want this to be available to public
+REVOKE ALL ON FUNCTION verify_zedstore(regclass) FROM PUBLIC;
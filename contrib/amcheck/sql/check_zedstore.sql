@@ -0,0 +1,41 @@
+CREATE TABLE zstest (id int8, t text, n numeric) USING zedstore;
+CREATE TABLE zstest_heap (id int8) USING heap;
+
+-- Stabalize tests
+ALTER TABLE zstest SET (autovacuum_enabled = false);
+
+CREATE ROLE regress_zstest_role;
+
+-- verify permissions are checked (error due to function not callable)
+SET ROLE regress_zstest_role;
+SELECT verify_zedstore('zstest'::regclass);
+RESET ROLE;
+
+GRANT EXECUTE ON FUNCTION verify_zedstore(regclass) TO regress_zstest_role;
+SET ROLE regress_zstest_role;
+SELECT verify_zedstore('zstest');
+RESET ROLE;
+
+-- only zedstore tables can be checked
+SELECT verify_zedstore('zstest_heap');
+
+-- trees with several levels
+INSERT INTO zstest SELECT i, repeat('x', i % 50), i / 3.0
+  FROM generate_series(1, 100000) i;
+SELECT verify_zedstore('zstest');
+
+-- after removing rows
+DELETE FROM zstest WHERE id % 7 = 0 OR id BETWEEN 20000 AND 40000;
+VACUUM zstest;
+SELECT verify_zedstore('zstest');
+
+-- with an attribute tree that's created later
+ALTER TABLE zstest ADD COLUMN extra int4;
+INSERT INTO zstest VALUES (0, 'new', 0, 1);
+SELECT verify_zedstore('zstest');
+
+-- cleanup
+DROP TABLE zstest;
+DROP TABLE zstest_heap;
+DROP OWNED BY regress_zstest_role; -- permissions
+DROP ROLE regress_zstest_role;
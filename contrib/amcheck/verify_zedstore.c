@@ -0,0 +1,646 @@
+/*-------------------------------------------------------------------------
+ *
+ * verify_zedstore.c
+ *		Verifies the integrity of the B-trees of a zedstore table.
+ *
+ * A zedstore table consists of a TID tree and one B-tree per attribute,
+ * all keyed by TID, and all reachable from the root directory on the
+ * metapage.  verify_zedstore() walks each of the trees from its root, and
+ * checks that:
+ *
+ * - every page is a B-tree page of the right attribute and level,
+ * - the key range of every child page is exactly the range its downlink
+ *	 and the next downlink in the parent page give,
+ * - the right-links of each level chain the pages together in key order,
+ *	 starting from the lowest and ending at the highest possible TID,
+ * - the TID array items on the TID tree's leaf pages are in order, decode
+ *	 to the TIDs they claim to hold, and stay within the page's key range,
+ * - the attribute streams on the attribute trees' leaf pages can be
+ *	 decoded, their TIDs are in ascending order, and stay within the page's
+ *	 key range.
+ *
+ * The table is locked in ShareLock mode, so the trees cannot change under
+ * us.  The first violation found is reported as an error.
+ *
+ * Pages that are not reachable from the metapage (UNDO log, toast and free
+ * pages) are not verified.
+ *
+ * Copyright (c) 2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/amcheck/verify_zedstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/table.h"
+#include "access/zedstore_internal.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_class.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "storage/lmgr.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+
+/* Deepest tree we're prepared to verify */
+#define ZS_CHECK_MAX_LEVELS		32
+
+/*
+ * State associated with verifying one zedstore table.
+ */
+typedef struct ZedstoreCheckState
+{
+	Relation	rel;
+	BlockNumber nblocks;
+	BufferAccessStrategy checkstrategy;
+
+	/* Per-page memory context, reset after each page is checked */
+	MemoryContext pagecontext;
+
+	/* Tree being verified */
+	AttrNumber	attno;
+
+	/*
+	 * Last page visited on each level of the current tree.  The tree is
+	 * walked depth-first, left to right, so this is the left sibling of the
+	 * next page we visit on the same level.
+	 */
+	BlockNumber prevblk[ZS_CHECK_MAX_LEVELS];
+	BlockNumber prevnext[ZS_CHECK_MAX_LEVELS];
+	zstid		prevhikey[ZS_CHECK_MAX_LEVELS];
+
+	/* For decoding leaf items */
+	ZSTidItemIterator tiditer;
+	attstream_decoder decoder;
+} ZedstoreCheckState;
+
+PG_FUNCTION_INFO_V1(verify_zedstore);
+
+static void zs_check_tree(ZedstoreCheckState *state, BlockNumber rootblk);
+static void zs_check_page(ZedstoreCheckState *state, BlockNumber blkno,
+						  int level, zstid lokey, zstid hikey);
+static void zs_check_internal_page(ZedstoreCheckState *state, BlockNumber blkno,
+								   Page page);
+static void zs_check_tid_leaf(ZedstoreCheckState *state, BlockNumber blkno,
+							  Page page);
+static void zs_check_attr_leaf(ZedstoreCheckState *state, BlockNumber blkno,
+							   Page page);
+static void zs_check_attstream(ZedstoreCheckState *state, BlockNumber blkno,
+							   Page page, ZSAttStream *stream, bool upper);
+static Page palloc_zedstore_page(ZedstoreCheckState *state, BlockNumber blkno);
+
+/*
+ * verify_zedstore(relation)
+ *
+ * Verify the TID tree and attribute trees of a zedstore table.
+ */
+Datum
+verify_zedstore(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	ZedstoreCheckState *state;
+	Relation	rel;
+	Page		metapage;
+	ZSMetaPageOpaque *metaopaque;
+	ZSMetaPage *metapg;
+	AttrNumber	attno;
+
+	/* ShareLock keeps out concurrent inserts, updates, deletes and vacuum */
+	rel = table_open(relid, ShareLock);
+
+	if ((rel->rd_rel->relkind != RELKIND_RELATION &&
+		 rel->rd_rel->relkind != RELKIND_MATVIEW) ||
+		rel->rd_rel->relam != ZEDSTORE_TABLE_AM_OID)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("only zedstore tables are supported"),
+				 errdetail("Relation \"%s\" is not a zedstore table.",
+						   RelationGetRelationName(rel))));
+
+	/*
+	 * We don't have visibility into the local buffers of other sessions, so
+	 * we can't verify their temporary tables.
+	 */
+	if (RELATION_IS_OTHER_TEMP(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions"),
+				 errdetail("Table \"%s\" is associated with temporary relation.",
+						   RelationGetRelationName(rel))));
+
+	state = palloc0(sizeof(ZedstoreCheckState));
+	state->rel = rel;
+	state->nblocks = RelationGetNumberOfBlocks(rel);
+	state->checkstrategy = GetAccessStrategy(BAS_BULKREAD);
+	state->pagecontext = AllocSetContextCreate(CurrentMemoryContext,
+											   "zedstore verification page context",
+											   ALLOCSET_DEFAULT_SIZES);
+	state->tiditer.context = state->pagecontext;
+
+	/* A table that has never been written to has no metapage yet */
+	if (state->nblocks == 0)
+	{
+		table_close(rel, ShareLock);
+		PG_RETURN_VOID();
+	}
+
+	metapage = palloc_zedstore_page(state, ZS_META_BLK);
+	metaopaque = (ZSMetaPageOpaque *) PageGetSpecialPointer(metapage);
+	metapg = (ZSMetaPage *) PageGetContents(metapage);
+
+	if (PageGetSpecialSize(metapage) != MAXALIGN(sizeof(ZSMetaPageOpaque)) ||
+		metaopaque->zs_page_id != ZS_META_PAGE_ID)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("block %u of zedstore table \"%s\" is not a metapage",
+						ZS_META_BLK, RelationGetRelationName(rel))));
+
+	/*
+	 * The root directory can be shorter than the tuple descriptor, if
+	 * columns were added since, but never longer.
+	 */
+	if (metapg->nattributes < 1 ||
+		metapg->nattributes > RelationGetNumberOfAttributes(rel) + 1 ||
+		((PageHeader) metapage)->pd_lower !=
+		(char *) &metapg->tree_root_dir[metapg->nattributes] - (char *) metapage)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("metapage of zedstore table \"%s\" has invalid root directory",
+						RelationGetRelationName(rel)),
+				 errdetail_internal("nattributes=%d pd_lower=%u.",
+									metapg->nattributes,
+									((PageHeader) metapage)->pd_lower)));
+
+	for (attno = ZS_META_ATTRIBUTE_NUM; attno < metapg->nattributes; attno++)
+	{
+		BlockNumber rootblk = metapg->tree_root_dir[attno].root;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* The tree is created lazily, on first insertion */
+		if (rootblk == InvalidBlockNumber)
+			continue;
+
+		if (attno != ZS_META_ATTRIBUTE_NUM)
+		{
+			Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel),
+												   attno - 1);
+
+			init_attstream_decoder(&state->decoder, attr->attbyval,
+								   attr->attlen);
+		}
+
+		state->attno = attno;
+		zs_check_tree(state, rootblk);
+
+		if (attno != ZS_META_ATTRIBUTE_NUM)
+			destroy_attstream_decoder(&state->decoder);
+	}
+
+	MemoryContextDelete(state->pagecontext);
+	FreeAccessStrategy(state->checkstrategy);
+	table_close(rel, ShareLock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Verify one tree, given its root block.
+ */
+static void
+zs_check_tree(ZedstoreCheckState *state, BlockNumber rootblk)
+{
+	Page		page;
+	ZSBtreePageOpaque *opaque;
+	int			rootlevel;
+	int			level;
+
+	if (rootblk >= state->nblocks)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("root block %u of attribute %d in zedstore table \"%s\" is beyond end of table",
+						rootblk, state->attno,
+						RelationGetRelationName(state->rel))));
+
+	page = palloc_zedstore_page(state, rootblk);
+	opaque = ZSBtreePageGetOpaque(page);
+	if ((opaque->zs_flags & ZSBT_ROOT) == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("root block %u of attribute %d in zedstore table \"%s\" is not marked as root",
+						rootblk, state->attno,
+						RelationGetRelationName(state->rel))));
+	rootlevel = opaque->zs_level;
+	pfree(page);
+
+	if (rootlevel >= ZS_CHECK_MAX_LEVELS)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("root block %u of attribute %d in zedstore table \"%s\" has implausible level %d",
+						rootblk, state->attno,
+						RelationGetRelationName(state->rel), rootlevel)));
+
+	for (level = 0; level < ZS_CHECK_MAX_LEVELS; level++)
+	{
+		state->prevblk[level] = InvalidBlockNumber;
+		state->prevnext[level] = InvalidBlockNumber;
+		state->prevhikey[level] = MinZSTid;
+	}
+
+	zs_check_page(state, rootblk, rootlevel, MinZSTid, MaxPlusOneZSTid);
+
+	/*
+	 * The rightmost page on each level must end the right-link chain.  (That
+	 * it covers the keys up to the end follows from the key range checks.)
+	 */
+	for (level = 0; level <= rootlevel; level++)
+	{
+		if (state->prevnext[level] != InvalidBlockNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("rightmost block %u on level %d of attribute %d in zedstore table \"%s\" has a right-link",
+							state->prevblk[level], level, state->attno,
+							RelationGetRelationName(state->rel)),
+					 errdetail_internal("Right-link=%u.",
+										state->prevnext[level])));
+	}
+}
+
+/*
+ * Verify one page, whose parent says it should be on 'level' and cover keys
+ * from 'lokey' up to, but not including, 'hikey'.  Recurses to the children
+ * of internal pages.
+ */
+static void
+zs_check_page(ZedstoreCheckState *state, BlockNumber blkno, int level,
+			  zstid lokey, zstid hikey)
+{
+	Page		page;
+	ZSBtreePageOpaque *opaque;
+
+	check_stack_depth();
+	CHECK_FOR_INTERRUPTS();
+
+	if (blkno == ZS_META_BLK || blkno >= state->nblocks)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("downlink on level %d of attribute %d in zedstore table \"%s\" points to invalid block %u",
+						level + 1, state->attno,
+						RelationGetRelationName(state->rel), blkno)));
+
+	page = palloc_zedstore_page(state, blkno);
+	opaque = ZSBtreePageGetOpaque(page);
+
+	if (opaque->zs_attno != state->attno || opaque->zs_level != level)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("block %u in zedstore table \"%s\" is not on the expected tree level",
+						blkno, RelationGetRelationName(state->rel)),
+				 errdetail_internal("Expected attribute %d level %d, found attribute %d level %d.",
+									state->attno, level,
+									opaque->zs_attno, opaque->zs_level)));
+
+	if (opaque->zs_lokey != lokey || opaque->zs_hikey != hikey)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("key range of block %u of attribute %d in zedstore table \"%s\" does not match its downlink",
+						blkno, state->attno,
+						RelationGetRelationName(state->rel)),
+				 errdetail_internal("Expected (" UINT64_FORMAT ", " UINT64_FORMAT "), found (" UINT64_FORMAT ", " UINT64_FORMAT ").",
+									lokey, hikey,
+									opaque->zs_lokey, opaque->zs_hikey)));
+
+	/* The left sibling must link to us, and end where we begin */
+	if (state->prevblk[level] == InvalidBlockNumber)
+	{
+		if (lokey != MinZSTid)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("leftmost block %u on level %d of attribute %d in zedstore table \"%s\" does not start at the lowest TID",
+							blkno, level, state->attno,
+							RelationGetRelationName(state->rel))));
+	}
+	else if (state->prevnext[level] != blkno ||
+			 state->prevhikey[level] != lokey)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("right-link of block %u on level %d of attribute %d in zedstore table \"%s\" does not point to its right sibling",
+						state->prevblk[level], level, state->attno,
+						RelationGetRelationName(state->rel)),
+				 errdetail_internal("Right-link=%u, expected %u.",
+									state->prevnext[level], blkno)));
+
+	state->prevblk[level] = blkno;
+	state->prevnext[level] = opaque->zs_next;
+	state->prevhikey[level] = hikey;
+
+	if (level > 0)
+		zs_check_internal_page(state, blkno, page);
+	else if (state->attno == ZS_META_ATTRIBUTE_NUM)
+		zs_check_tid_leaf(state, blkno, page);
+	else
+		zs_check_attr_leaf(state, blkno, page);
+
+	pfree(page);
+}
+
+/*
+ * Verify the downlinks on an internal page, and recurse to the children.
+ */
+static void
+zs_check_internal_page(ZedstoreCheckState *state, BlockNumber blkno, Page page)
+{
+	ZSBtreePageOpaque *opaque = ZSBtreePageGetOpaque(page);
+	ZSBtreeInternalPageItem *items = ZSBtreeInternalPageGetItems(page);
+	int			nitems = ZSBtreeInternalPageGetNumItems(page);
+	int			i;
+
+	if ((((PageHeader) page)->pd_lower - SizeOfPageHeaderData) %
+		sizeof(ZSBtreeInternalPageItem) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("internal block %u of attribute %d in zedstore table \"%s\" has invalid pd_lower %u",
+						blkno, state->attno,
+						RelationGetRelationName(state->rel),
+						((PageHeader) page)->pd_lower)));
+
+	if (nitems < 1 || items[0].tid != opaque->zs_lokey)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("first downlink of internal block %u of attribute %d in zedstore table \"%s\" does not match the page's low key",
+						blkno, state->attno,
+						RelationGetRelationName(state->rel))));
+
+	for (i = 1; i < nitems; i++)
+	{
+		if (items[i].tid <= items[i - 1].tid ||
+			items[i].tid >= opaque->zs_hikey)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("downlinks of internal block %u of attribute %d in zedstore table \"%s\" are out of order",
+							blkno, state->attno,
+							RelationGetRelationName(state->rel)),
+					 errdetail_internal("Item %d has key " UINT64_FORMAT ", previous key " UINT64_FORMAT ".",
+										i, items[i].tid, items[i - 1].tid)));
+	}
+
+	for (i = 0; i < nitems; i++)
+	{
+		zstid		childhikey;
+
+		childhikey = (i + 1 < nitems) ? items[i + 1].tid : opaque->zs_hikey;
+		zs_check_page(state, items[i].childblk, opaque->zs_level - 1,
+					  items[i].tid, childhikey);
+	}
+}
+
+/*
+ * Verify the TID array items on a leaf page of the TID tree.
+ */
+static void
+zs_check_tid_leaf(ZedstoreCheckState *state, BlockNumber blkno, Page page)
+{
+	ZSBtreePageOpaque *opaque = ZSBtreePageGetOpaque(page);
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	OffsetNumber off;
+	zstid		prevendtid = opaque->zs_lokey;
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(state->pagecontext);
+
+	for (off = FirstOffsetNumber; off <= maxoff; off++)
+	{
+		ItemId		iid = PageGetItemId(page, off);
+		ZSTidArrayItem *item;
+		int			i;
+
+		if (!ItemIdIsNormal(iid) ||
+			ItemIdGetOffset(iid) < ((PageHeader) page)->pd_upper ||
+			ItemIdGetOffset(iid) + ItemIdGetLength(iid) > ((PageHeader) page)->pd_special ||
+			ItemIdGetLength(iid) < offsetof(ZSTidArrayItem, t_payload))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid line pointer %u in block %u of TID tree in zedstore table \"%s\"",
+							off, blkno, RelationGetRelationName(state->rel))));
+
+		item = (ZSTidArrayItem *) PageGetItem(page, iid);
+
+		if (item->t_size != ItemIdGetLength(iid) ||
+			item->t_num_tids < 1 ||
+			item->t_num_tids > ZSBT_MAX_ITEM_TIDS ||
+			item->t_num_codewords > ZSBT_MAX_ITEM_CODEWORDS ||
+			item->t_num_undo_slots < ZSBT_FIRST_NORMAL_UNDO_SLOT ||
+			item->t_num_undo_slots > ZSBT_MAX_ITEM_UNDO_SLOTS ||
+			item->t_size != SizeOfZSTidArrayItem(item->t_num_tids,
+												 item->t_num_undo_slots,
+												 item->t_num_codewords))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid TID array item %u in block %u of TID tree in zedstore table \"%s\"",
+							off, blkno, RelationGetRelationName(state->rel))));
+
+		if (item->t_firsttid < prevendtid ||
+			item->t_endtid <= item->t_firsttid ||
+			item->t_endtid > opaque->zs_hikey)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("TID array item %u in block %u of TID tree in zedstore table \"%s\" is out of order",
+							off, blkno, RelationGetRelationName(state->rel)),
+					 errdetail_internal("Item covers (" UINT64_FORMAT ", " UINT64_FORMAT "), previous item ended at " UINT64_FORMAT ", page ends at " UINT64_FORMAT ".",
+										item->t_firsttid, item->t_endtid,
+										prevendtid, opaque->zs_hikey)));
+
+		zsbt_tid_item_unpack(item, &state->tiditer);
+
+		for (i = 0; i < state->tiditer.num_tids; i++)
+		{
+			zstid		tid = state->tiditer.tids[i];
+
+			if ((i == 0 && tid != item->t_firsttid) ||
+				(i > 0 && tid <= state->tiditer.tids[i - 1]) ||
+				tid >= item->t_endtid ||
+				state->tiditer.tid_undoslotnos[i] >= item->t_num_undo_slots)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("TID array item %u in block %u of TID tree in zedstore table \"%s\" does not decode correctly",
+								off, blkno, RelationGetRelationName(state->rel)),
+						 errdetail_internal("TID " UINT64_FORMAT " at position %d.",
+											tid, i)));
+		}
+		if (state->tiditer.tids[state->tiditer.num_tids - 1] != item->t_endtid - 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("TID array item %u in block %u of TID tree in zedstore table \"%s\" does not decode correctly",
+							off, blkno, RelationGetRelationName(state->rel)),
+					 errdetail_internal("Last TID " UINT64_FORMAT ", expected " UINT64_FORMAT ".",
+										state->tiditer.tids[state->tiditer.num_tids - 1],
+										item->t_endtid - 1)));
+
+		prevendtid = item->t_endtid;
+	}
+
+	/* The iterator's arrays live in pagecontext, so forget them */
+	state->tiditer.tids = NULL;
+	state->tiditer.tid_undoslotnos = NULL;
+	state->tiditer.tids_allocated_size = 0;
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextReset(state->pagecontext);
+}
+
+/*
+ * Verify the attribute streams on a leaf page of an attribute tree.
+ *
+ * A leaf page holds up to two streams: an uncompressed one right after the
+ * page header, and a compressed one at the end of the page, just before the
+ * special area.
+ */
+static void
+zs_check_attr_leaf(ZedstoreCheckState *state, BlockNumber blkno, Page page)
+{
+	PageHeader	phdr = (PageHeader) page;
+	int			lowersize = phdr->pd_lower - SizeOfPageHeaderData;
+	int			uppersize = phdr->pd_special - phdr->pd_upper;
+
+	if ((lowersize != 0 && lowersize <= SizeOfZSAttStreamHeader) ||
+		(uppersize != 0 && uppersize <= SizeOfZSAttStreamHeader))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid attribute stream sizes in block %u of attribute %d in zedstore table \"%s\"",
+						blkno, state->attno,
+						RelationGetRelationName(state->rel)),
+				 errdetail_internal("Lower stream %d bytes, upper stream %d bytes.",
+									lowersize, uppersize)));
+
+	if (lowersize > 0)
+		zs_check_attstream(state, blkno, page,
+						   (ZSAttStream *) ((char *) page + SizeOfPageHeaderData),
+						   false);
+	if (uppersize > 0)
+		zs_check_attstream(state, blkno, page,
+						   (ZSAttStream *) ((char *) page + phdr->pd_upper),
+						   true);
+}
+
+/*
+ * Decode one attribute stream in full, checking its TIDs.
+ */
+static void
+zs_check_attstream(ZedstoreCheckState *state, BlockNumber blkno, Page page,
+				   ZSAttStream *stream, bool upper)
+{
+	ZSBtreePageOpaque *opaque = ZSBtreePageGetOpaque(page);
+	PageHeader	phdr = (PageHeader) page;
+	int			areasize;
+	bool		compressed = (stream->t_flags & ATTSTREAM_COMPRESSED) != 0;
+	attstream_decoder *decoder = &state->decoder;
+	zstid		prevtid = InvalidZSTid;
+	uint64		nelems = 0;
+
+	if (upper)
+		areasize = phdr->pd_special - phdr->pd_upper;
+	else
+		areasize = phdr->pd_lower - SizeOfPageHeaderData;
+
+	/*
+	 * By convention, the lower stream is never compressed and the upper one
+	 * always is.  Sanity check the header before handing the stream to the
+	 * decoder, which trusts it.
+	 */
+	if (stream->t_size != areasize ||
+		compressed != upper ||
+		(compressed &&
+		 (stream->t_decompressed_size > stream->t_decompressed_bufsize ||
+		  stream->t_decompressed_bufsize > MaxAllocSize)))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid %s attribute stream header in block %u of attribute %d in zedstore table \"%s\"",
+						upper ? "upper" : "lower", blkno, state->attno,
+						RelationGetRelationName(state->rel))));
+
+	decode_attstream_begin(decoder, stream);
+	while (decode_attstream_cont(decoder))
+	{
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < decoder->num_elements; i++)
+		{
+			zstid		tid = decoder->tids[i];
+
+			if (tid <= prevtid ||
+				tid < opaque->zs_lokey ||
+				tid >= opaque->zs_hikey)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("%s attribute stream in block %u of attribute %d in zedstore table \"%s\" has TIDs out of order",
+								upper ? "upper" : "lower", blkno, state->attno,
+								RelationGetRelationName(state->rel)),
+						 errdetail_internal("TID " UINT64_FORMAT " follows " UINT64_FORMAT ", page covers (" UINT64_FORMAT ", " UINT64_FORMAT ").",
+											tid, prevtid,
+											opaque->zs_lokey, opaque->zs_hikey)));
+			prevtid = tid;
+			nelems++;
+		}
+	}
+
+	if (decoder->pos != decoder->chunks_len ||
+		nelems == 0 ||
+		prevtid != stream->t_lasttid)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("%s attribute stream in block %u of attribute %d in zedstore table \"%s\" does not decode correctly",
+						upper ? "upper" : "lower", blkno, state->attno,
+						RelationGetRelationName(state->rel)),
+				 errdetail_internal("Decoded " UINT64_FORMAT " elements from %d of %d bytes, last TID " UINT64_FORMAT ", expected " UINT64_FORMAT ".",
+									nelems, decoder->pos, decoder->chunks_len,
+									prevtid, stream->t_lasttid)));
+}
+
+/*
+ * Return a palloc'd copy of a zedstore B-tree (or meta) page, after basic
+ * sanity checks.
+ *
+ * We copy the page into local storage to avoid holding pin on the buffer
+ * longer than we must.
+ */
+static Page
+palloc_zedstore_page(ZedstoreCheckState *state, BlockNumber blkno)
+{
+	Buffer		buffer;
+	Page		page;
+	PageHeader	phdr;
+
+	page = palloc(BLCKSZ);
+
+	buffer = ReadBufferExtended(state->rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								state->checkstrategy);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	memcpy(page, BufferGetPage(buffer), BLCKSZ);
+	UnlockReleaseBuffer(buffer);
+
+	phdr = (PageHeader) page;
+	if (PageIsNew(page) ||
+		phdr->pd_lower < SizeOfPageHeaderData ||
+		phdr->pd_lower > phdr->pd_upper ||
+		phdr->pd_upper > phdr->pd_special ||
+		phdr->pd_special > BLCKSZ)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("block %u in zedstore table \"%s\" has an invalid page header",
+						blkno, RelationGetRelationName(state->rel))));
+
+	if (blkno != ZS_META_BLK &&
+		(PageGetSpecialSize(page) != MAXALIGN(sizeof(ZSBtreePageOpaque)) ||
+		 ZSBtreePageGetOpaque(page)->zs_page_id != ZS_BTREE_PAGE_ID))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("block %u in zedstore table \"%s\" is not a B-tree page",
+						blkno, RelationGetRelationName(state->rel))));
+
+	return page;
+}
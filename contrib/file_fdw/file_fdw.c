@@ -13,6 +13,7 @@
 #include "postgres.h"
 
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include "access/htup_details.h"
@@ -27,18 +28,39 @@
 #include "commands/vacuum.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "pgstat.h"
+#include "storage/condition_variable.h"
+#include "storage/fd.h"
+#include "storage/spin.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/sampling.h"
 
 PG_MODULE_MAGIC;
 
+/*
+ * Approximate number of bytes of the file handed out at a time to the
+ * processes taking part in a parallel scan.
+ */
+#define FILE_FDW_CHUNK_SIZE		(1024 * 1024)
+
+/*
+ * Maximum number of bytes read while looking for the end of a chunk.  If no
+ * record boundary is found within that many bytes, e.g. because a quote is
+ * never closed, the process that claimed the chunk reads the rest of the
+ * file by itself.
+ */
+#define FILE_FDW_MAX_CHUNK_SIZE	(64 * 1024 * 1024)
+
 /*
  * Describes the valid options for objects that use this wrapper.
  */
@@ -95,6 +117,29 @@ typedef struct FileFdwPlanState
 	double		ntuples;		/* estimate of number of data rows */
 } FileFdwPlanState;
 
+/*
+ * State of a parallel-aware scan, shared by the participating processes
+ * through dynamic shared memory.
+ *
+ * The file is handed out in chunks of about FILE_FDW_CHUNK_SIZE bytes, each
+ * ending at a record boundary.  Since a CSV record may contain quoted
+ * newlines, that boundary can only be found by reading forward from a known
+ * boundary, so chunks are claimed one at a time: the claiming process reads
+ * the chunk and publishes where the next one starts.  Parsing the records,
+ * which is the expensive part, then proceeds in parallel.  Once a chunk is
+ * found to contain the end-of-data marker, or to have no end within
+ * FILE_FDW_MAX_CHUNK_SIZE bytes, no further chunks are handed out.
+ */
+typedef struct FileFdwParallelState
+{
+	slock_t		mutex;			/* protects the following fields */
+	off_t		next_offset;	/* file offset of the first unclaimed record */
+	bool		header_pending; /* must the header line still be skipped? */
+	bool		claiming;		/* is some process reading the next chunk? */
+	bool		eof;			/* has the whole file been claimed? */
+	ConditionVariable cv;		/* signaled when claiming is cleared */
+} FileFdwParallelState;
+
 /*
  * FDW-specific information for ForeignScanState.fdw_state.
  */
@@ -105,8 +150,44 @@ typedef struct FileFdwExecutionState
 	List	   *options;		/* merged COPY options, excluding filename and
 								 * is_program */
 	CopyState	cstate;			/* COPY execution state */
+
+	/* The rest is used only by parallel-aware scans */
+	bool		parallel;		/* feeding chunks of the file to COPY? */
+	bool		whole_file;		/* reading the whole file in one process? */
+	bool		header;			/* does the file start with a header line? */
+	bool		csv_mode;		/* CSV format, rather than text? */
+	char		quote;			/* CSV quote character */
+	char		escape;			/* CSV escape character, or \0 if same as quote */
+	int			fd;				/* file descriptor to read chunks from */
+	char	   *chunk;			/* current chunk of the file */
+	int			chunk_len;		/* number of valid bytes in chunk */
+	int			chunk_pos;		/* number of bytes passed to COPY so far */
+	int			chunk_alloc;	/* allocated size of chunk */
+
+	/* State of the search for a record boundary in the current chunk */
+	int			scan_pos;		/* next byte to examine */
+	bool		scan_line_start;	/* is scan_pos at the start of a record? */
+	bool		scan_in_quote;	/* CSV quote state, as in CopyReadLineText() */
+	bool		scan_last_was_esc;
+	bool		scan_end_of_data;	/* found the end-of-data marker? */
+
+	/* Set when the rest of the file is read past the current chunk */
+	bool		streaming;		/* reading on past the end of the chunk? */
+	bool		stream_skip_header; /* must the header line still be skipped? */
+	bool		stream_eof;		/* reached the end of the file? */
+	off_t		stream_offset;	/* file offset to read from next */
+	FileFdwParallelState *pstate;	/* shared state, or local_state if the
+									 * scan is run without shared memory */
+	FileFdwParallelState local_state;
 } FileFdwExecutionState;
 
+/*
+ * Scan whose chunks file_read_chunk() returns.  COPY's data source callback
+ * gets no private argument, so this is set for the duration of each
+ * NextCopyFrom() call of a parallel-aware scan.
+ */
+static FileFdwExecutionState *chunk_source = NULL;
+
 /*
  * SQL functions
  */
@@ -139,6 +220,17 @@ static bool fileAnalyzeForeignTable(Relation relation,
 									BlockNumber *totalpages);
 static bool fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 										  RangeTblEntry *rte);
+static Size fileEstimateDSMForeignScan(ForeignScanState *node,
+									   ParallelContext *pcxt);
+static void fileInitializeDSMForeignScan(ForeignScanState *node,
+										 ParallelContext *pcxt,
+										 void *coordinate);
+static void fileReInitializeDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt,
+										   void *coordinate);
+static void fileInitializeWorkerForeignScan(ForeignScanState *node,
+											shm_toc *toc,
+											void *coordinate);
 
 /*
  * Helper functions
@@ -156,7 +248,24 @@ static void estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 						  FileFdwPlanState *fdw_private);
 static void estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 						   FileFdwPlanState *fdw_private,
+						   double parallel_divisor,
 						   Cost *startup_cost, Cost *total_cost);
+static double file_parallel_divisor(int parallel_workers);
+static bool file_parallel_options(List *options, bool *header, bool *csv_mode,
+								  char *quote, char *escape);
+static bool file_can_scan_in_parallel(FileFdwPlanState *fdw_private);
+static CopyState file_begin_copy(ForeignScanState *node,
+								 FileFdwExecutionState *festate);
+static void file_init_parallel_state(FileFdwParallelState *pstate,
+									 bool header);
+static int	file_read_chunk(void *outbuf, int minread, int maxread);
+static bool file_claim_chunk(FileFdwExecutionState *festate);
+static bool file_claim_whole_file(FileFdwExecutionState *festate);
+static void file_reset_record_scan(FileFdwExecutionState *festate);
+static int	file_find_record_end(FileFdwExecutionState *festate,
+								 const char *buf, int len, int minlen,
+								 bool at_eof);
+static bool file_stream_read(FileFdwExecutionState *festate);
 static int	file_acquire_sample_rows(Relation onerel, int elevel,
 									 HeapTuple *rows, int targrows,
 									 double *totalrows, double *totaldeadrows);
@@ -181,6 +290,10 @@ file_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->EndForeignScan = fileEndForeignScan;
 	fdwroutine->AnalyzeForeignTable = fileAnalyzeForeignTable;
 	fdwroutine->IsForeignScanParallelSafe = fileIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = fileEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = fileInitializeDSMForeignScan;
+	fdwroutine->ReInitializeDSMForeignScan = fileReInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = fileInitializeWorkerForeignScan;
 
 	PG_RETURN_POINTER(fdwroutine);
 }
@@ -525,7 +638,7 @@ fileGetForeignRelSize(PlannerInfo *root,
  *
  *		Currently we don't support any push-down feature, so there is only one
  *		possible access path, which simply returns all records in the order in
- *		the data file.
+ *		the data file; plus, for a regular file, a parallel-aware variant of it.
  */
 static void
 fileGetForeignPaths(PlannerInfo *root,
@@ -546,7 +659,7 @@ fileGetForeignPaths(PlannerInfo *root,
 										  (Node *) columns, -1));
 
 	/* Estimate costs */
-	estimate_costs(root, baserel, fdw_private,
+	estimate_costs(root, baserel, fdw_private, 1.0,
 				   &startup_cost, &total_cost);
 
 	/*
@@ -569,6 +682,44 @@ fileGetForeignPaths(PlannerInfo *root,
 									 NULL,	/* no extra plan */
 									 coptions));
 
+	/*
+	 * If the file can be split into chunks of whole records, consider a
+	 * partial path too, in which each participating process parses the
+	 * chunks it claims.  Partial paths can't be parameterized, though.
+	 */
+	if (baserel->consider_parallel && baserel->lateral_relids == NULL &&
+		file_can_scan_in_parallel(fdw_private))
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel,
+												   fdw_private->pages, -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			double		parallel_divisor;
+			ForeignPath *path;
+
+			parallel_divisor = file_parallel_divisor(parallel_workers);
+			estimate_costs(root, baserel, fdw_private, parallel_divisor,
+						   &startup_cost, &total_cost);
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   clamp_row_est(baserel->rows /
+														 parallel_divisor),
+										   startup_cost,
+										   total_cost,
+										   NIL, /* no pathkeys */
+										   NULL,	/* no outer rel either */
+										   NULL,	/* no extra plan */
+										   coptions);
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
+
 	/*
 	 * If data file was sorted, and we knew it somehow, we could insert
 	 * appropriate pathkeys into the ForeignPath node to tell the planner
@@ -654,7 +805,6 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	char	   *filename;
 	bool		is_program;
 	List	   *options;
-	CopyState	cstate;
 	FileFdwExecutionState *festate;
 
 	/*
@@ -670,27 +820,71 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	/* Add any options from the plan (currently only convert_selectively) */
 	options = list_concat(options, plan->fdw_private);
 
-	/*
-	 * Create CopyState from FDW options.  We always acquire all columns, so
-	 * as to match the expected ScanTupleSlot signature.
-	 */
-	cstate = BeginCopyFrom(NULL,
-						   node->ss.ss_currentRelation,
-						   filename,
-						   is_program,
-						   NULL,
-						   NIL,
-						   options);
-
 	/*
 	 * Save state in node->fdw_state.  We must save enough information to call
 	 * BeginCopyFrom() again.
 	 */
-	festate = (FileFdwExecutionState *) palloc(sizeof(FileFdwExecutionState));
+	festate = (FileFdwExecutionState *) palloc0(sizeof(FileFdwExecutionState));
 	festate->filename = filename;
 	festate->is_program = is_program;
 	festate->options = options;
-	festate->cstate = cstate;
+
+	/*
+	 * A parallel-aware scan reads the file itself, a chunk at a time, and
+	 * feeds the chunks to COPY.  The header line is skipped by whichever
+	 * process claims the first chunk, so COPY itself must not skip any line.
+	 * Until the scan is attached to shared memory, chunks are claimed from
+	 * local state, so that the scan works without any workers, too.
+	 *
+	 * The file may no longer be splittable at execution time, e.g. if the
+	 * client encoding has been changed since the plan was made.  Then the
+	 * whole file is claimed by one process, which reads it like a
+	 * non-parallel scan does, while the other processes return no rows.
+	 */
+	if (plan->scan.plan.parallel_aware &&
+		!file_parallel_options(options, &festate->header,
+							   &festate->csv_mode,
+							   &festate->quote, &festate->escape))
+	{
+		festate->whole_file = true;
+		festate->header = false;
+		festate->pstate = &festate->local_state;
+		file_init_parallel_state(festate->pstate, false);
+
+		/* The CopyState is created once the file has been claimed */
+		node->fdw_state = (void *) festate;
+		return;
+	}
+
+	if (plan->scan.plan.parallel_aware)
+	{
+		List	   *copy_options = NIL;
+		ListCell   *lc;
+
+		foreach(lc, options)
+		{
+			DefElem    *def = (DefElem *) lfirst(lc);
+
+			if (strcmp(def->defname, "header") != 0)
+				copy_options = lappend(copy_options, def);
+		}
+		festate->options = copy_options;
+
+		festate->fd = OpenTransientFile(filename, O_RDONLY | PG_BINARY);
+		if (festate->fd < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\" for reading: %m",
+							filename)));
+
+		festate->parallel = true;
+		festate->chunk_alloc = FILE_FDW_CHUNK_SIZE;
+		festate->chunk = palloc(festate->chunk_alloc);
+		festate->pstate = &festate->local_state;
+		file_init_parallel_state(festate->pstate, festate->header);
+	}
+
+	festate->cstate = file_begin_copy(node, festate);
 
 	node->fdw_state = (void *) festate;
 }
@@ -727,6 +921,19 @@ fileIterateForeignScan(ForeignScanState *node)
 	 * foreign tables.
 	 */
 	ExecClearTuple(slot);
+	if (festate->cstate == NULL)
+	{
+		Assert(festate->whole_file);
+		if (!file_claim_whole_file(festate))
+		{
+			error_context_stack = errcallback.previous;
+			return slot;
+		}
+		festate->cstate = file_begin_copy(node, festate);
+		errcallback.arg = (void *) festate->cstate;
+	}
+	if (festate->parallel)
+		chunk_source = festate;
 	found = NextCopyFrom(festate->cstate, NULL,
 						 slot->tts_values, slot->tts_isnull);
 	if (found)
@@ -747,15 +954,32 @@ fileReScanForeignScan(ForeignScanState *node)
 {
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
-	EndCopyFrom(festate->cstate);
+	if (festate->cstate)
+		EndCopyFrom(festate->cstate);
 
-	festate->cstate = BeginCopyFrom(NULL,
-									node->ss.ss_currentRelation,
-									festate->filename,
-									festate->is_program,
-									NULL,
-									NIL,
-									festate->options);
+	/*
+	 * Forget about the current chunk of a parallel-aware scan.  Shared state
+	 * is reset by fileReInitializeDSMForeignScan(), but local state is ours.
+	 */
+	if (festate->parallel)
+	{
+		festate->chunk_len = 0;
+		festate->chunk_pos = 0;
+		festate->streaming = false;
+		if (festate->pstate == &festate->local_state)
+			file_init_parallel_state(festate->pstate, festate->header);
+	}
+
+	/* A whole-file scan must claim the file again */
+	if (festate->whole_file)
+	{
+		festate->cstate = NULL;
+		if (festate->pstate == &festate->local_state)
+			file_init_parallel_state(festate->pstate, false);
+		return;
+	}
+
+	festate->cstate = file_begin_copy(node, festate);
 }
 
 /*
@@ -769,7 +993,12 @@ fileEndForeignScan(ForeignScanState *node)
 
 	/* if festate is NULL, we are in EXPLAIN; nothing to do */
 	if (festate)
-		EndCopyFrom(festate->cstate);
+	{
+		if (festate->cstate)
+			EndCopyFrom(festate->cstate);
+		if (festate->parallel)
+			CloseTransientFile(festate->fd);
+	}
 }
 
 /*
@@ -834,6 +1063,58 @@ fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * fileEstimateDSMForeignScan
+ *		Estimate the shared memory needed by a parallel-aware scan
+ */
+static Size
+fileEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(FileFdwParallelState);
+}
+
+/*
+ * fileInitializeDSMForeignScan
+ *		Set up the shared state of a parallel-aware scan
+ */
+static void
+fileInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+
+	file_init_parallel_state(pstate, festate->header);
+	festate->pstate = pstate;
+}
+
+/*
+ * fileReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel-aware scan for a rescan
+ */
+static void
+fileReInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							   void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+
+	file_init_parallel_state(pstate, festate->header);
+}
+
+/*
+ * fileInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel-aware scan
+ */
+static void
+fileInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+
+	festate->pstate = (FileFdwParallelState *) coordinate;
+}
+
 /*
  * check_selective_binary_conversion
  *
@@ -1051,6 +1332,7 @@ estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 static void
 estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 			   FileFdwPlanState *fdw_private,
+			   double parallel_divisor,
 			   Cost *startup_cost, Cost *total_cost)
 {
 	BlockNumber pages = fdw_private->pages;
@@ -1068,15 +1350,515 @@ estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 	 * from reality, but we have no good alternative; and it's not clear that
 	 * the numbers we produce here matter much anyway, since there's only one
 	 * access path for the rel.
+	 *
+	 * In a parallel-aware scan, the CPU cost is divided among the processes,
+	 * but as in cost_seqscan(), the I/O cost is assumed not to be.
 	 */
 	run_cost += seq_page_cost * pages;
 
 	*startup_cost = baserel->baserestrictcost.startup;
 	cpu_per_tuple = cpu_tuple_cost * 10 + baserel->baserestrictcost.per_tuple;
-	run_cost += cpu_per_tuple * ntuples;
+	run_cost += cpu_per_tuple * ntuples / parallel_divisor;
 	*total_cost = *startup_cost + run_cost;
 }
 
+/*
+ * Estimate the share of the work done by each process in a parallel-aware
+ * scan with the given number of workers; see get_parallel_divisor().
+ */
+static double
+file_parallel_divisor(int parallel_workers)
+{
+	double		parallel_divisor = parallel_workers;
+
+	if (parallel_leader_participation)
+	{
+		double		leader_contribution;
+
+		leader_contribution = 1.0 - (0.3 * parallel_workers);
+		if (leader_contribution > 0)
+			parallel_divisor += leader_contribution;
+	}
+
+	return parallel_divisor;
+}
+
+/*
+ * Check whether a file read with the given COPY options can be split into
+ * chunks at record boundaries, and if so, return the settings needed to find
+ * those boundaries.
+ *
+ * That is possible for text and CSV format, as long as the file's encoding
+ * never uses ASCII bytes within multibyte characters, which holds for all
+ * encodings allowed as server encodings.
+ */
+static bool
+file_parallel_options(List *options, bool *header, bool *csv_mode,
+					  char *quote, char *escape)
+{
+	int			file_encoding = pg_get_client_encoding();
+	char	   *quote_str = NULL;
+	char	   *escape_str = NULL;
+	ListCell   *lc;
+
+	*header = false;
+	*csv_mode = false;
+
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "format") == 0)
+		{
+			char	   *format = defGetString(def);
+
+			if (strcmp(format, "csv") == 0)
+				*csv_mode = true;
+			else if (strcmp(format, "text") != 0)
+				return false;
+		}
+		else if (strcmp(def->defname, "header") == 0)
+			*header = defGetBoolean(def);
+		else if (strcmp(def->defname, "quote") == 0)
+			quote_str = defGetString(def);
+		else if (strcmp(def->defname, "escape") == 0)
+			escape_str = defGetString(def);
+		else if (strcmp(def->defname, "encoding") == 0)
+			file_encoding = pg_char_to_encoding(defGetString(def));
+	}
+
+	if (!PG_VALID_BE_ENCODING(file_encoding))
+		return false;
+
+	/* Same defaults as in ProcessCopyOptions() */
+	*quote = quote_str ? quote_str[0] : '"';
+	*escape = escape_str ? escape_str[0] : *quote;
+	/* ignore special escape processing if it's the same as quote */
+	if (*escape == *quote)
+		*escape = '\0';
+
+	return true;
+}
+
+/*
+ * Check whether a parallel-aware scan of the foreign table is possible: the
+ * data must come from a regular file, which each process can read at any
+ * offset, in a format that can be split into chunks.
+ */
+static bool
+file_can_scan_in_parallel(FileFdwPlanState *fdw_private)
+{
+	struct stat stat_buf;
+	bool		header;
+	bool		csv_mode;
+	char		quote;
+	char		escape;
+
+	if (fdw_private->is_program ||
+		stat(fdw_private->filename, &stat_buf) < 0 ||
+		!S_ISREG(stat_buf.st_mode))
+		return false;
+
+	return file_parallel_options(fdw_private->options, &header, &csv_mode,
+								 &quote, &escape);
+}
+
+/*
+ * Create the CopyState used to parse the records of the foreign table.
+ *
+ * We always acquire all columns, so as to match the expected ScanTupleSlot
+ * signature.
+ */
+static CopyState
+file_begin_copy(ForeignScanState *node, FileFdwExecutionState *festate)
+{
+	/* A parallel-aware scan feeds COPY the chunks this process claims */
+	if (festate->parallel)
+		return BeginCopyFrom(NULL,
+							 node->ss.ss_currentRelation,
+							 NULL,
+							 false,
+							 file_read_chunk,
+							 NIL,
+							 festate->options);
+
+	return BeginCopyFrom(NULL,
+						 node->ss.ss_currentRelation,
+						 festate->filename,
+						 festate->is_program,
+						 NULL,
+						 NIL,
+						 festate->options);
+}
+
+/*
+ * (Re)initialize the state of a parallel-aware scan to start at the
+ * beginning of the file.
+ */
+static void
+file_init_parallel_state(FileFdwParallelState *pstate, bool header)
+{
+	SpinLockInit(&pstate->mutex);
+	pstate->next_offset = 0;
+	pstate->header_pending = header;
+	pstate->claiming = false;
+	pstate->eof = false;
+	ConditionVariableInit(&pstate->cv);
+}
+
+/*
+ * COPY data source callback of parallel-aware scans: return the next bytes
+ * of the chunks claimed by this process, or 0 once the file is exhausted.
+ *
+ * Since every chunk ends at a record boundary, COPY sees a stream of whole
+ * records, just as if it was reading a file containing only them.
+ */
+static int
+file_read_chunk(void *outbuf, int minread, int maxread)
+{
+	FileFdwExecutionState *festate = chunk_source;
+	int			nbytes;
+
+	Assert(festate != NULL && festate->parallel);
+
+	while (festate->chunk_pos >= festate->chunk_len)
+	{
+		if (festate->streaming)
+		{
+			if (!file_stream_read(festate))
+				return 0;
+		}
+		else if (!file_claim_chunk(festate))
+			return 0;
+	}
+
+	nbytes = Min(maxread, festate->chunk_len - festate->chunk_pos);
+	memcpy(outbuf, festate->chunk + festate->chunk_pos, nbytes);
+	festate->chunk_pos += nbytes;
+
+	return nbytes;
+}
+
+/*
+ * Claim the next chunk of the file and read it into festate->chunk.
+ *
+ * Returns false if there is nothing left to claim.  The chunk claimed may be
+ * empty.
+ */
+static bool
+file_claim_chunk(FileFdwExecutionState *festate)
+{
+	FileFdwParallelState *pstate = festate->pstate;
+	off_t		start;
+	int			len = 0;
+	int			header_len;
+	int			end;
+	bool		at_eof = false;
+	bool		eof = false;
+
+	/* Wait until no other process is in the middle of claiming a chunk */
+	for (;;)
+	{
+		SpinLockAcquire(&pstate->mutex);
+		if (pstate->eof)
+		{
+			SpinLockRelease(&pstate->mutex);
+			ConditionVariableCancelSleep();
+			return false;
+		}
+		if (!pstate->claiming)
+		{
+			pstate->claiming = true;
+			start = pstate->next_offset;
+			header_len = pstate->header_pending ? -1 : 0;
+			SpinLockRelease(&pstate->mutex);
+			break;
+		}
+		SpinLockRelease(&pstate->mutex);
+
+		ConditionVariableSleep(&pstate->cv, PG_WAIT_EXTENSION);
+	}
+	ConditionVariableCancelSleep();
+
+	/*
+	 * Read from the start of the chunk until we have found the header line,
+	 * if it has to be skipped, and then the first record boundary at least
+	 * FILE_FDW_CHUNK_SIZE bytes past it; or until the end of the file or of
+	 * the data.
+	 *
+	 * If we don't find the end of the chunk within FILE_FDW_MAX_CHUNK_SIZE
+	 * bytes, give up on splitting the file: this process will read the rest
+	 * of it, and nothing more is handed out.
+	 */
+	file_reset_record_scan(festate);
+	for (;;)
+	{
+		ssize_t		nread;
+
+		if (len == festate->chunk_alloc)
+		{
+			if (festate->chunk_alloc >= FILE_FDW_MAX_CHUNK_SIZE)
+			{
+				festate->streaming = true;
+				festate->stream_skip_header = (header_len < 0);
+				festate->stream_eof = false;
+				festate->stream_offset = start + len;
+				if (header_len < 0)
+					header_len = len;
+				end = len;
+				eof = true;
+				break;
+			}
+			festate->chunk_alloc *= 2;
+			festate->chunk = repalloc(festate->chunk, festate->chunk_alloc);
+		}
+
+		nread = pg_pread(festate->fd, festate->chunk + len,
+						 festate->chunk_alloc - len, start + len);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							festate->filename)));
+		if (nread == 0)
+			at_eof = true;
+		len += nread;
+
+		if (header_len < 0)
+		{
+			header_len = file_find_record_end(festate, festate->chunk, len, 1,
+											  at_eof);
+			if (header_len < 0 && at_eof)
+				header_len = len;
+			if (festate->scan_end_of_data)
+			{
+				/* nothing follows the end-of-data marker */
+				end = header_len;
+				eof = true;
+				break;
+			}
+			if (header_len >= 0)
+				file_reset_record_scan(festate);
+		}
+		if (header_len >= 0)
+		{
+			end = file_find_record_end(festate, festate->chunk + header_len,
+									   len - header_len, FILE_FDW_CHUNK_SIZE,
+									   at_eof);
+			if (end >= 0)
+			{
+				end += header_len;
+				eof = festate->scan_end_of_data;
+				break;
+			}
+			if (at_eof)
+			{
+				end = len;
+				eof = true;
+				break;
+			}
+		}
+	}
+
+	/* Let the next claimant continue where this chunk ends */
+	SpinLockAcquire(&pstate->mutex);
+	pstate->next_offset = start + end;
+	pstate->header_pending = false;
+	pstate->eof = eof;
+	pstate->claiming = false;
+	SpinLockRelease(&pstate->mutex);
+	ConditionVariableBroadcast(&pstate->cv);
+
+	festate->chunk_pos = header_len;
+	festate->chunk_len = end;
+
+	return true;
+}
+
+/*
+ * Read the next bytes of the file past the chunk this process has claimed
+ * last, after giving up on splitting the file.  Skips the header line, if
+ * that hasn't been found within the chunk.
+ *
+ * Returns false at the end of the file.
+ */
+static bool
+file_stream_read(FileFdwExecutionState *festate)
+{
+	for (;;)
+	{
+		int			keep = 0;
+		ssize_t		nread;
+
+		if (festate->stream_eof)
+			return false;
+
+		/* Keep the bytes not yet examined while looking for the header end */
+		if (festate->stream_skip_header)
+		{
+			keep = festate->chunk_len - festate->scan_pos;
+			memmove(festate->chunk, festate->chunk + festate->scan_pos, keep);
+			festate->scan_pos = 0;
+		}
+
+		nread = pg_pread(festate->fd, festate->chunk + keep,
+						 festate->chunk_alloc - keep, festate->stream_offset);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							festate->filename)));
+		if (nread == 0)
+			festate->stream_eof = true;
+		festate->stream_offset += nread;
+		festate->chunk_len = keep + nread;
+		festate->chunk_pos = 0;
+
+		if (festate->stream_skip_header)
+		{
+			int			header_len;
+
+			header_len = file_find_record_end(festate, festate->chunk,
+											  festate->chunk_len, 1,
+											  festate->stream_eof);
+			if (header_len < 0 && !festate->stream_eof)
+				continue;
+			festate->stream_skip_header = false;
+			if (header_len < 0 || festate->scan_end_of_data)
+			{
+				/* nothing but the header, or it was the end-of-data marker */
+				festate->stream_eof = true;
+				return false;
+			}
+			festate->chunk_pos = header_len;
+		}
+
+		if (festate->chunk_pos < festate->chunk_len)
+			return true;
+	}
+}
+
+/*
+ * Claim the whole file for a parallel-aware scan that can't be split into
+ * chunks.  Returns false if another process has claimed it, or any part of
+ * it, already.
+ */
+static bool
+file_claim_whole_file(FileFdwExecutionState *festate)
+{
+	FileFdwParallelState *pstate = festate->pstate;
+	bool		claimed;
+
+	SpinLockAcquire(&pstate->mutex);
+	claimed = !pstate->eof && !pstate->claiming && pstate->next_offset == 0;
+	if (claimed)
+		pstate->eof = true;
+	SpinLockRelease(&pstate->mutex);
+
+	return claimed;
+}
+
+/*
+ * Start looking for a record boundary at the start of a new buffer.
+ */
+static void
+file_reset_record_scan(FileFdwExecutionState *festate)
+{
+	festate->scan_pos = 0;
+	festate->scan_line_start = true;
+	festate->scan_in_quote = false;
+	festate->scan_last_was_esc = false;
+	festate->scan_end_of_data = false;
+}
+
+/*
+ * Return the length of the shortest prefix of buf, at least minlen bytes
+ * long, that ends at a record boundary, or -1 if buf contains no such
+ * boundary yet.  buf must start at a record boundary.
+ *
+ * The search continues where the previous call for the same buf left off,
+ * so that the caller can read more data into buf and call us again; use
+ * file_reset_record_scan() to start on a new buffer.  Unless at_eof says
+ * that buf extends to the end of the file, we stop a few bytes short of its
+ * end, so that there's always room to look ahead.
+ *
+ * Records end at a newline, a carriage return, or both, as recognized by
+ * CopyReadLineText(), except that in text format a newline can be escaped
+ * with a backslash, and in CSV format it can be quoted.  If we find the
+ * end-of-data marker, \. alone on a line, we return the end of that line
+ * regardless of minlen and set festate->scan_end_of_data, since COPY stops
+ * reading there.  (In text format, COPY treats \. anywhere as the marker.)
+ */
+static int
+file_find_record_end(FileFdwExecutionState *festate,
+					 const char *buf, int len, int minlen, bool at_eof)
+{
+	int			limit = at_eof ? len : len - 3;
+	int			i = festate->scan_pos;
+
+	while (i < limit)
+	{
+		char		c = buf[i];
+		int			end = -1;
+
+		if (c == '\\' && i + 1 < len && buf[i + 1] == '.' &&
+			(!festate->csv_mode ||
+			 (festate->scan_line_start &&
+			  (i + 2 == len || buf[i + 2] == '\r' || buf[i + 2] == '\n'))))
+		{
+			end = i + 2;
+			if (end < len && buf[end] == '\r')
+				end++;
+			if (end < len && buf[end] == '\n')
+				end++;
+			festate->scan_end_of_data = true;
+			festate->scan_pos = end;
+			return end;
+		}
+		festate->scan_line_start = false;
+
+		if (festate->csv_mode)
+		{
+			if (festate->scan_in_quote && c == festate->escape)
+				festate->scan_last_was_esc = !festate->scan_last_was_esc;
+			if (c == festate->quote && !festate->scan_last_was_esc)
+				festate->scan_in_quote = !festate->scan_in_quote;
+			if (c != festate->escape)
+				festate->scan_last_was_esc = false;
+		}
+		else if (c == '\\')
+		{
+			/* skip the escaped character */
+			i += 2;
+			continue;
+		}
+
+		if (!festate->scan_in_quote)
+		{
+			if (c == '\n')
+				end = i + 1;
+			else if (c == '\r')
+				end = (i + 1 < len && buf[i + 1] == '\n') ? i + 2 : i + 1;
+		}
+		if (end < 0)
+		{
+			i++;
+			continue;
+		}
+
+		festate->scan_line_start = true;
+		i = end;
+		if (end >= minlen)
+		{
+			festate->scan_pos = end;
+			return end;
+		}
+	}
+
+	festate->scan_pos = Min(i, len);
+	return -1;
+}
+
 /*
  * file_acquire_sample_rows -- acquire a random sample of rows from the table
  *
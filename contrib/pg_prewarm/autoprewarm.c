@@ -10,11 +10,16 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		master worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, there's a master worker that reads and sorts the
+ *		list of blocks to be prewarmed and then launches one or more
+ *		per-database workers for each relevant database in turn.  The
+ *		former keeps running after the initial prewarm is complete to
+ *		update the dump file periodically.
+ *
+ *		Blocks are loaded hottest first, by the usage count their buffers
+ *		had when the dump was taken, because we stop as soon as we run out
+ *		of free buffers.  Optionally, the pages of zedstore tables that
+ *		nearly every access goes through are loaded before anything else.
  *
  *	Copyright (c) 2016-2019, PostgreSQL Global Development Group
  *
@@ -30,11 +35,13 @@
 
 #include "access/relation.h"
 #include "access/xact.h"
+#include "access/zedstore_internal.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
+#include "postmaster/postmaster.h"
 #include "storage/buf_internals.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
@@ -54,6 +61,15 @@
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
+/* Number of blocks a per-database worker claims at a time. */
+#define APW_BATCH_SIZE 32
+
+/*
+ * Blocks whose buffers had at least this usage count when they were dumped
+ * are loaded before the other blocks of their database.
+ */
+#define APW_HOT_USAGECOUNT 2
+
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
 {
@@ -62,6 +78,8 @@ typedef struct BlockInfoRecord
 	Oid			filenode;
 	ForkNumber	forknum;
 	BlockNumber blocknum;
+	uint32		usagecount;		/* buffer usage count at dump time */
+	bool		zedstore_hot;	/* see apw_is_zedstore_hot_page() */
 } BlockInfoRecord;
 
 /* Shared state information for autoprewarm bgworker. */
@@ -76,7 +94,8 @@ typedef struct AutoPrewarmSharedState
 	Oid			database;
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
+	pg_atomic_uint32 prewarm_next_idx;	/* next block to hand out */
+	pg_atomic_uint32 prewarmed_blocks;
 } AutoPrewarmSharedState;
 
 void		_PG_init(void);
@@ -89,9 +108,11 @@ PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 static void apw_load_buffers(void);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_master_worker(void);
-static void apw_start_database_worker(void);
+static void apw_start_database_workers(void);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
+static bool apw_is_zedstore_hot_page(Page page);
+static int	apw_block_priority(const BlockInfoRecord *blk);
 static int	apw_compare_blockinfo(const void *p, const void *q);
 static void apw_sigterm_handler(SIGNAL_ARGS);
 static void apw_sighup_handler(SIGNAL_ARGS);
@@ -106,6 +127,8 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval;	/* dump interval */
+static int	autoprewarm_workers = 1;	/* workers per database */
+static bool autoprewarm_zedstore_first = false; /* zedstore-aware order */
 
 /*
  * Module load callback.
@@ -125,6 +148,29 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the number of workers that prewarm each database.",
+							NULL,
+							&autoprewarm_workers,
+							1,
+							1, MAX_BACKENDS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pg_prewarm.autoprewarm_zedstore_first",
+							 "Prewarms the metapages, B-tree internal pages and TID trees of zedstore tables first.",
+							 NULL,
+							 &autoprewarm_zedstore_first,
+							 false,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -172,6 +218,9 @@ autoprewarm_main(Datum main_arg)
 	/* Set on-detach hook so that our PID will be cleared on exit. */
 	on_shmem_exit(apw_detach_shmem, 0);
 
+	/* We pin buffers while dumping, so we need a resource owner. */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "autoprewarm");
+
 	/*
 	 * Store our PID in the shared memory area --- unless there's already
 	 * another worker running, in which case just exit.
@@ -264,8 +313,8 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers, one database at a
+ * time, to prewarm the buffers found there.
  */
 static void
 apw_load_buffers(void)
@@ -324,18 +373,32 @@ apw_load_buffers(void)
 	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
 	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
 
-	/* Read records, one per line. */
+	/*
+	 * Read records, one per line.  Files written before the usage count and
+	 * the zedstore page hint were added have only the first five fields.
+	 */
 	for (i = 0; i < num_elements; i++)
 	{
+		char		line[128];
 		unsigned	forknum;
+		unsigned	zedstore_hot = 0;
+		int			nfields;
 
-		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
-				   &blkinfo[i].tablespace, &blkinfo[i].filenode,
-				   &forknum, &blkinfo[i].blocknum) != 5)
+		blkinfo[i].usagecount = 0;
+		if (fgets(line, sizeof(line), file) == NULL)
+			nfields = 0;
+		else
+			nfields = sscanf(line, "%u,%u,%u,%u,%u,%u,%u",
+							 &blkinfo[i].database, &blkinfo[i].tablespace,
+							 &blkinfo[i].filenode, &forknum,
+							 &blkinfo[i].blocknum, &blkinfo[i].usagecount,
+							 &zedstore_hot);
+		if (nfields != 5 && nfields != 7)
 			ereport(ERROR,
 					(errmsg("autoprewarm block dump file is corrupted at line %d",
 							i + 1)));
 		blkinfo[i].forknum = forknum;
+		blkinfo[i].zedstore_hot = (zedstore_hot != 0);
 	}
 
 	FreeFile(file);
@@ -347,7 +410,7 @@ apw_load_buffers(void)
 	/* Populate shared memory state. */
 	apw_state->block_info_handle = dsm_segment_handle(seg);
 	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
-	apw_state->prewarmed_blocks = 0;
+	pg_atomic_write_u32(&apw_state->prewarmed_blocks, 0);
 
 	/* Get the info position of the first block of the next database. */
 	while (apw_state->prewarm_start_idx < num_elements)
@@ -387,6 +450,8 @@ apw_load_buffers(void)
 		/* Configure stop point and database for next per-database worker. */
 		apw_state->prewarm_stop_idx = j;
 		apw_state->database = current_db;
+		pg_atomic_write_u32(&apw_state->prewarm_next_idx,
+							apw_state->prewarm_start_idx);
 		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
 
 		/* If we've run out of free buffers, don't launch another worker. */
@@ -394,10 +459,10 @@ apw_load_buffers(void)
 			break;
 
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Start per-database workers to load blocks for this database; this
+		 * function will return once all of them have exited.
 		 */
-		apw_start_database_worker();
+		apw_start_database_workers();
 
 		/* Prepare for next database. */
 		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
@@ -413,17 +478,21 @@ apw_load_buffers(void)
 	/* Report our success. */
 	ereport(LOG,
 			(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
-					apw_state->prewarmed_blocks, num_elements)));
+					pg_atomic_read_u32(&apw_state->prewarmed_blocks),
+					num_elements)));
 }
 
 /*
- * Prewarm all blocks for one database (and possibly also global objects, if
- * those got grouped with this database).
+ * Prewarm blocks for one database (and possibly also global objects, if
+ * those got grouped with this database).  When there are several workers
+ * for the database, they hand out the blocks in small batches, so that
+ * the hottest blocks are still loaded first.
  */
 void
 autoprewarm_database_main(Datum main_arg)
 {
-	int			pos;
+	int			pos = 0;
+	int			batch_end = 0;
 	BlockInfoRecord *block_info;
 	Relation	rel = NULL;
 	BlockNumber nblocks = 0;
@@ -443,19 +512,29 @@ autoprewarm_database_main(Datum main_arg)
 				 errmsg("could not map dynamic shared memory segment")));
 	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (have_free_buffer())
 	{
-		BlockInfoRecord *blk = &block_info[pos++];
+		BlockInfoRecord *blk;
 		Buffer		buf;
 
 		CHECK_FOR_INTERRUPTS();
 
+		/* Claim the next batch of blocks, once we're done with this one. */
+		if (pos >= batch_end)
+		{
+			pos = (int) pg_atomic_fetch_add_u32(&apw_state->prewarm_next_idx,
+												APW_BATCH_SIZE);
+			if (pos >= apw_state->prewarm_stop_idx)
+				break;
+			batch_end = Min(pos + APW_BATCH_SIZE, apw_state->prewarm_stop_idx);
+		}
+		blk = &block_info[pos++];
+
 		/*
 		 * Quit if we've reached records for another database. If previous
 		 * blocks are of some global objects, then continue pre-warming.
@@ -532,7 +611,7 @@ autoprewarm_database_main(Datum main_arg)
 								 NULL);
 		if (BufferIsValid(buf))
 		{
-			apw_state->prewarmed_blocks++;
+			pg_atomic_fetch_add_u32(&apw_state->prewarmed_blocks, 1);
 			ReleaseBuffer(buf);
 		}
 
@@ -562,6 +641,7 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	int			i;
 	int			ret;
 	BlockInfoRecord *block_info_array;
+	Buffer	   *hot_candidates = NULL;
 	BufferDesc *bufHdr;
 	FILE	   *file;
 	char		transient_dump_file_path[MAXPGPATH];
@@ -588,6 +668,8 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 
 	block_info_array =
 		(BlockInfoRecord *) palloc(sizeof(BlockInfoRecord) * NBuffers);
+	if (autoprewarm_zedstore_first)
+		hot_candidates = (Buffer *) palloc(sizeof(Buffer) * NBuffers);
 
 	for (num_blocks = 0, i = 0; i < NBuffers; i++)
 	{
@@ -613,12 +695,58 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 			block_info_array[num_blocks].filenode = bufHdr->tag.rnode.relNode;
 			block_info_array[num_blocks].forknum = bufHdr->tag.forkNum;
 			block_info_array[num_blocks].blocknum = bufHdr->tag.blockNum;
+			block_info_array[num_blocks].usagecount =
+				BUF_STATE_GET_USAGECOUNT(buf_state);
+			block_info_array[num_blocks].zedstore_hot = false;
+			if (hot_candidates)
+				hot_candidates[num_blocks] =
+					((buf_state & BM_VALID) &&
+					 bufHdr->tag.forkNum == MAIN_FORKNUM) ?
+					BufferDescriptorGetBuffer(bufHdr) : InvalidBuffer;
 			++num_blocks;
 		}
 
 		UnlockBufHdr(bufHdr, buf_state);
 	}
 
+	/*
+	 * Look for hot zedstore pages among the blocks we found.  We mustn't
+	 * look at the pages while holding the buffer header spinlocks above, so
+	 * pin each buffer again, if it still holds the same block, and examine
+	 * it under a share lock.  Don't wait for buffers that are locked
+	 * exclusively, though; the dump shouldn't stall behind a busy page, and
+	 * missing a hot page only means it's loaded a little later.
+	 */
+	if (hot_candidates)
+	{
+		for (i = 0; i < num_blocks; i++)
+		{
+			BlockInfoRecord *blk = &block_info_array[i];
+			RelFileNode rnode;
+			Buffer		buf = hot_candidates[i];
+
+			CHECK_FOR_INTERRUPTS();
+
+			if (!BufferIsValid(buf))
+				continue;
+
+			rnode.spcNode = blk->tablespace;
+			rnode.dbNode = blk->database;
+			rnode.relNode = blk->filenode;
+			if (!ReadRecentBuffer(rnode, MAIN_FORKNUM, blk->blocknum, buf))
+				continue;
+
+			if (!ConditionalLockBufferInMode(buf, BUFFER_LOCK_SHARE))
+			{
+				ReleaseBuffer(buf);
+				continue;
+			}
+			blk->zedstore_hot = apw_is_zedstore_hot_page(BufferGetPage(buf));
+			UnlockReleaseBuffer(buf);
+		}
+		pfree(hot_candidates);
+	}
+
 	snprintf(transient_dump_file_path, MAXPGPATH, "%s.tmp", AUTOPREWARM_FILE);
 	file = AllocateFile(transient_dump_file_path, "w");
 	if (!file)
@@ -645,12 +773,14 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	{
 		CHECK_FOR_INTERRUPTS();
 
-		ret = fprintf(file, "%u,%u,%u,%u,%u\n",
+		ret = fprintf(file, "%u,%u,%u,%u,%u,%u,%u\n",
 					  block_info_array[i].database,
 					  block_info_array[i].tablespace,
 					  block_info_array[i].filenode,
 					  (uint32) block_info_array[i].forknum,
-					  block_info_array[i].blocknum);
+					  block_info_array[i].blocknum,
+					  block_info_array[i].usagecount,
+					  block_info_array[i].zedstore_hot ? 1 : 0);
 		if (ret < 0)
 		{
 			int			save_errno = errno;
@@ -763,6 +893,8 @@ apw_init_shmem(void)
 		LWLockInitialize(&apw_state->lock, LWLockNewTrancheId());
 		apw_state->bgworker_pid = InvalidPid;
 		apw_state->pid_using_dumpfile = InvalidPid;
+		pg_atomic_init_u32(&apw_state->prewarm_next_idx, 0);
+		pg_atomic_init_u32(&apw_state->prewarmed_blocks, 0);
 	}
 	LWLockRelease(AddinShmemInitLock);
 
@@ -828,13 +960,18 @@ apw_start_master_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start autoprewarm per-database worker processes, and wait for all of them
+ * to exit.  If we can't get as many workers as configured, make do with the
+ * ones we got.
  */
 static void
-apw_start_database_worker(void)
+apw_start_database_workers(void)
 {
 	BackgroundWorker worker;
-	BackgroundWorkerHandle *handle;
+	BackgroundWorkerHandle **handles;
+	int			nworkers = autoprewarm_workers;
+	int			nlaunched = 0;
+	int			i;
 
 	MemSet(&worker, 0, sizeof(BackgroundWorker));
 	worker.bgw_flags =
@@ -849,17 +986,31 @@ apw_start_database_worker(void)
 	/* must set notify PID to wait for shutdown */
 	worker.bgw_notify_pid = MyProcPid;
 
-	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
-		ereport(ERROR,
-				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
-				 errmsg("registering dynamic bgworker autoprewarm failed"),
-				 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
+	handles = (BackgroundWorkerHandle **)
+		palloc(sizeof(BackgroundWorkerHandle *) * nworkers);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker, &handles[nlaunched]))
+		{
+			if (nlaunched > 0)
+				break;
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("registering dynamic bgworker autoprewarm failed"),
+					 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
+		}
+		nlaunched++;
+	}
 
 	/*
-	 * Ignore return value; if it fails, postmaster has died, but we have
+	 * Ignore return values; if it fails, postmaster has died, but we have
 	 * checks for that elsewhere.
 	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	for (i = 0; i < nlaunched; i++)
+		WaitForBackgroundWorkerShutdown(handles[i]);
+
+	pfree(handles);
 }
 
 /* Compare member elements to check whether they are not equal. */
@@ -871,22 +1022,84 @@ do { \
 		return 1;				\
 } while(0)
 
+/*
+ * Does this buffer hold a zedstore page that nearly every access to the
+ * table goes through?  Those are the metapage, the internal pages of all
+ * the B-trees, all pages of the TID tree, and the rightmost leaf of each
+ * attribute tree, where new rows are added.
+ *
+ * The caller must hold a pin and a share lock on the buffer.  Pages of
+ * other kinds of relations may look like zedstore pages by accident, but a
+ * wrong answer only affects the order in which blocks are prewarmed.
+ */
+static bool
+apw_is_zedstore_hot_page(Page page)
+{
+	PageHeader	phdr = (PageHeader) page;
+
+	if (phdr->pd_special == BLCKSZ - MAXALIGN(sizeof(ZSMetaPageOpaque)))
+	{
+		ZSMetaPageOpaque *opaque;
+
+		opaque = (ZSMetaPageOpaque *) PageGetSpecialPointer(page);
+		if (opaque->zs_page_id == ZS_META_PAGE_ID)
+			return true;
+	}
+
+	if (phdr->pd_special == BLCKSZ - MAXALIGN(sizeof(ZSBtreePageOpaque)))
+	{
+		ZSBtreePageOpaque *opaque = ZSBtreePageGetOpaque(page);
+
+		if (opaque->zs_page_id == ZS_BTREE_PAGE_ID)
+			return opaque->zs_level > 0 ||
+				opaque->zs_attno == ZS_META_ATTRIBUTE_NUM ||
+				opaque->zs_hikey == MaxPlusOneZSTid;
+	}
+
+	return false;
+}
+
+/*
+ * apw_block_priority
+ *
+ * Coarse classification of a block, for the order of prewarming: 0 for the
+ * hot zedstore pages if pg_prewarm.autoprewarm_zedstore_first is set, 1 for
+ * other blocks that were used frequently, and 2 for everything else.
+ */
+static int
+apw_block_priority(const BlockInfoRecord *blk)
+{
+	if (autoprewarm_zedstore_first && blk->zedstore_hot)
+		return 0;
+	if (blk->usagecount >= APW_HOT_USAGECOUNT)
+		return 1;
+	return 2;
+}
+
 /*
  * apw_compare_blockinfo
  *
  * We depend on all records for a particular database being consecutive
  * in the dump file; each per-database worker will preload blocks until
- * it sees a block for some other database.  Sorting by tablespace,
- * filenode, forknum, and blocknum isn't critical for correctness, but
- * helps us get a sequential I/O pattern.
+ * it sees a block for some other database.  Within a database, the blocks
+ * in the more important priority classes are loaded first, since we stop
+ * once we run out of free buffers.  Only a few classes are used, so that
+ * within each of them, sorting by tablespace, filenode, forknum, and
+ * blocknum still reads each relation mostly sequentially.
  */
 static int
 apw_compare_blockinfo(const void *p, const void *q)
 {
 	const BlockInfoRecord *a = (const BlockInfoRecord *) p;
 	const BlockInfoRecord *b = (const BlockInfoRecord *) q;
+	int			pa;
+	int			pb;
 
 	cmp_member_elem(database);
+	pa = apw_block_priority(a);
+	pb = apw_block_priority(b);
+	if (pa != pb)
+		return pa < pb ? -1 : 1;
 	cmp_member_elem(tablespace);
 	cmp_member_elem(filenode);
 	cmp_member_elem(forknum);
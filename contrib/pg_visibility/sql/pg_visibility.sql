@@ -72,6 +72,23 @@ select count(*) > 0 from pg_visibility_map_summary('test_partition');
 select * from pg_check_frozen('test_partition'); -- hopefully none
 select pg_truncate_visibility_map('test_partition');
 
+-- vacuum freezes the pages it marks all-visible right away
+create table eager_freeze_test (a int);
+insert into eager_freeze_test select generate_series(1, 1000);
+vacuum eager_freeze_test;
+select all_visible > 0 as visible, all_frozen = all_visible as frozen
+  from pg_visibility_map_summary('eager_freeze_test');
+select * from pg_check_frozen('eager_freeze_test'); -- hopefully none
+
+-- ... unless disabled
+create table lazy_freeze_test (a int);
+insert into lazy_freeze_test select generate_series(1, 1000);
+set vacuum_eager_freeze = off;
+vacuum lazy_freeze_test;
+reset vacuum_eager_freeze;
+select all_visible > 0 as visible, all_frozen = 0 as not_frozen
+  from pg_visibility_map_summary('lazy_freeze_test');
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
@@ -81,3 +98,5 @@ drop server dummy_server;
 drop foreign data wrapper dummy;
 drop materialized view matview_visibility_test;
 drop table regular_table;
+drop table eager_freeze_test;
+drop table lazy_freeze_test;
@@ -0,0 +1,21 @@
+/* contrib/pgstattuple/pgstattuple--1.5--1.6.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pgstattuple UPDATE TO '1.6'" to load this file. \quit
+
+CREATE FUNCTION pgstatzedstore(IN relname regclass,
+    OUT attno INT4,			-- attribute number, 0 for the TID tree
+    OUT tree_pages BIGINT,		-- number of B-tree pages
+    OUT leaf_pages BIGINT,		-- number of B-tree leaf pages
+    OUT free_space BIGINT,		-- free space on B-tree pages in bytes
+    OUT item_count BIGINT,		-- number of live TIDs or values
+    OUT dead_item_count BIGINT,		-- number of dead TIDs or values
+    OUT stored_len BIGINT,		-- leaf data length in bytes, as stored
+    OUT uncompressed_len BIGINT,	-- leaf data length in bytes, uncompressed
+    OUT toast_pages BIGINT)		-- number of toast pages
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pgstatzedstore'
+LANGUAGE C STRICT PARALLEL SAFE;
+
+REVOKE EXECUTE ON FUNCTION pgstatzedstore(regclass) FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pgstatzedstore(regclass) TO pg_stat_scan_tables;
@@ -0,0 +1,638 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgstatzedstore.c
+ *	  Functions for investigating the space usage of zedstore tables.
+ *
+ * A zedstore table has no heap tuples, so pgstattuple() doesn't apply.
+ * Instead, pgstatzedstore() reports, for the TID tree and for each
+ * attribute tree, how many pages it has, how much free space there is on
+ * them, how many live and dead items it holds, and how much space its
+ * leaf data takes with and without compression.
+ *
+ * The TID tree is read first, in TID order, to count live and dead TIDs
+ * and to remember the dead ones.  A TID is dead if VACUUM has already marked
+ * it so, or if its UNDO record says that it was inserted by a transaction
+ * that aborted or deleted by one that committed, whether or not some old
+ * snapshot can still see it; the same rows that pgstattuple() counts as
+ * dead in a heap table.  The rest of the table is then read once in
+ * physical order, decoding the attribute streams on the leaf pages of the
+ * attribute trees.  That part is divided between parallel workers, if the
+ * table is large enough for a parallel scan.  Only an AccessShareLock is
+ * held, so like pgstattuple() the result is not an exact snapshot if the
+ * table is being modified concurrently.
+ *
+ * Copyright (c) 2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/pgstattuple/pgstatzedstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "access/relation.h"
+#include "access/xact.h"
+#include "access/zedstore_internal.h"
+#include "access/zedstore_undorec.h"
+#include "catalog/pg_am_d.h"
+#include "catalog/pg_class.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "optimizer/cost.h"
+#include "optimizer/paths.h"
+#include "port/atomics.h"
+#include "storage/bufmgr.h"
+#include "storage/procarray.h"
+#include "utils/builtins.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+PG_FUNCTION_INFO_V1(pgstatzedstore);
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_PGSTATZS_SHARED	UINT64CONST(0xA000000000000001)
+#define PARALLEL_KEY_PGSTATZS_DEAD_TIDS	UINT64CONST(0xA000000000000002)
+
+/*
+ * Statistics of one tree.  For the TID tree, the items are TIDs; for the
+ * attribute trees, they're the values stored for each TID.
+ */
+typedef struct pgstatzedstore_type
+{
+	uint64		tree_pages;
+	uint64		leaf_pages;
+	uint64		free_space;
+	uint64		item_count;
+	uint64		dead_item_count;
+	uint64		stored_len;		/* bytes of leaf data, as stored */
+	uint64		uncompressed_len;	/* bytes of leaf data, uncompressed */
+	uint64		toast_pages;
+} pgstatzedstore_type;
+
+#define PGSTATZEDSTORE_COLUMNS	9
+
+/*
+ * Dead TIDs found in the TID tree, in ascending order.
+ */
+typedef struct pgstatzedstore_dead_tids
+{
+	zstid	   *tids;
+	uint64		ntids;
+	uint64		maxtids;
+} pgstatzedstore_dead_tids;
+
+/*
+ * State shared with the parallel workers.  The workers claim blocks to read
+ * from 'nextblock', and each accumulates its statistics in its own slice of
+ * 'stats', natts + 1 entries for each worker.
+ */
+typedef struct pgstatzedstore_shared
+{
+	Oid			relid;
+	int			natts;
+	BlockNumber nblocks;
+	uint64		ndead;
+	pg_atomic_uint32 nextblock;
+	pgstatzedstore_type stats[FLEXIBLE_ARRAY_MEMBER];
+} pgstatzedstore_shared;
+
+PGDLLEXPORT void pgstatzedstore_worker(dsm_segment *seg, shm_toc *toc);
+
+static void pgstat_zs_tid_tree(Relation rel, pgstatzedstore_type *stat,
+							   pgstatzedstore_dead_tids *dead);
+static int	pgstat_zs_compute_workers(Relation rel, BlockNumber nblocks);
+static void pgstat_zs_parallel_scan(Relation rel, int nworkers,
+									BlockNumber nblocks,
+									pgstatzedstore_dead_tids *dead,
+									pgstatzedstore_type *stats, int natts);
+static void pgstat_zs_scan_blocks(Relation rel, pg_atomic_uint32 *nextblock,
+								  BlockNumber nblocks,
+								  zstid *dead_tids, uint64 ndead,
+								  pgstatzedstore_type *stats, int natts);
+static void pgstat_zs_attstream(ZSAttStream *stream, attstream_decoder *decoder,
+								zstid *dead_tids, uint64 ndead,
+								pgstatzedstore_type *stat);
+static bool pgstat_zs_tid_is_dead(zstid tid, zstid *dead_tids, uint64 ndead);
+
+/*
+ * pgstatzedstore(regclass)
+ *
+ * Returns one row for the TID tree (attno 0), and one for each attribute.
+ */
+Datum
+pgstatzedstore(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Relation	rel;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	pgstatzedstore_type *stats;
+	pgstatzedstore_dead_tids dead;
+	BlockNumber nblocks;
+	int			nworkers;
+	int			natts;
+	int			attno;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Switch into long-lived context to construct returned data structures */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	rel = relation_open(relid, AccessShareLock);
+
+	if ((rel->rd_rel->relkind != RELKIND_RELATION &&
+		 rel->rd_rel->relkind != RELKIND_MATVIEW) ||
+		rel->rd_rel->relam != ZEDSTORE_TABLE_AM_OID)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("\"%s\" is not a zedstore table",
+						RelationGetRelationName(rel))));
+
+	/*
+	 * Reject attempts to read non-local temporary relations; we would be
+	 * likely to get wrong data since we have no visibility into the owning
+	 * session's local buffers.
+	 */
+	if (RELATION_IS_OTHER_TEMP(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	natts = RelationGetNumberOfAttributes(rel);
+	stats = palloc0(sizeof(pgstatzedstore_type) * (natts + 1));
+
+	/* Count live and dead TIDs first, so that we can recognize dead values */
+	pgstat_zs_tid_tree(rel, &stats[ZS_META_ATTRIBUTE_NUM], &dead);
+
+	/* then scan all blocks but the metapage in physical order */
+	nblocks = RelationGetNumberOfBlocks(rel);
+	nworkers = pgstat_zs_compute_workers(rel, nblocks);
+	if (nworkers > 0)
+		pgstat_zs_parallel_scan(rel, nworkers, nblocks, &dead, stats, natts);
+	else
+	{
+		pg_atomic_uint32 nextblock;
+
+		pg_atomic_init_u32(&nextblock, ZS_META_BLK + 1);
+		pgstat_zs_scan_blocks(rel, &nextblock, nblocks, dead.tids, dead.ntids,
+							  stats, natts);
+	}
+
+	relation_close(rel, AccessShareLock);
+
+	for (attno = ZS_META_ATTRIBUTE_NUM; attno <= natts; attno++)
+	{
+		pgstatzedstore_type *stat = &stats[attno];
+		Datum		values[PGSTATZEDSTORE_COLUMNS];
+		bool		nulls[PGSTATZEDSTORE_COLUMNS];
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(attno);
+		values[1] = Int64GetDatum(stat->tree_pages);
+		values[2] = Int64GetDatum(stat->leaf_pages);
+		values[3] = Int64GetDatum(stat->free_space);
+		values[4] = Int64GetDatum(stat->item_count);
+		values[5] = Int64GetDatum(stat->dead_item_count);
+		values[6] = Int64GetDatum(stat->stored_len);
+		values[7] = Int64GetDatum(stat->uncompressed_len);
+		values[8] = Int64GetDatum(stat->toast_pages);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Walk the leaf level of the TID tree, in TID order, counting the live and
+ * dead TIDs.  The dead TIDs are collected in *dead.
+ */
+static void
+pgstat_zs_tid_tree(Relation rel, pgstatzedstore_type *stat,
+				   pgstatzedstore_dead_tids *dead)
+{
+	ZSTidItemIterator iter;
+	ZSTidTreeScan scan;
+	SnapshotData SnapshotNonVacuumable;
+	Buffer		buf = InvalidBuffer;
+	zstid		nexttid = MinZSTid;
+	zstid		lastdead = InvalidZSTid;
+	BlockNumber nextblock = InvalidBlockNumber;
+
+	dead->maxtids = 1024;
+	dead->ntids = 0;
+	dead->tids = palloc(dead->maxtids * sizeof(zstid));
+
+	memset(&iter, 0, sizeof(ZSTidItemIterator));
+	iter.context = CurrentMemoryContext;
+
+	/*
+	 * Like VACUUM, judge the UNDO records against the oldest xmin of any
+	 * transaction.  We only need a dummy scan to pass the snapshot.
+	 */
+	InitNonVacuumableSnapshot(SnapshotNonVacuumable,
+							  GetOldestXmin(rel, PROCARRAY_FLAGS_VACUUM));
+	memset(&scan, 0, sizeof(scan));
+	scan.rel = rel;
+	scan.snapshot = &SnapshotNonVacuumable;
+	scan.recent_oldest_undo = zsundo_get_oldest_undo_ptr(rel, false);
+
+	while (nexttid < MaxPlusOneZSTid)
+	{
+		Page		page;
+		ZSBtreePageOpaque *opaque;
+		OffsetNumber maxoff;
+		OffsetNumber off;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/*
+		 * Follow the right-link if we can.  If the page was split or
+		 * recycled meanwhile, descend the tree again instead.
+		 */
+		if (nextblock != InvalidBlockNumber)
+		{
+			buf = ReleaseAndReadBuffer(buf, rel, nextblock);
+			LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+			if (!zsbt_page_is_expected(rel, ZS_META_ATTRIBUTE_NUM, nexttid, 0, buf))
+			{
+				UnlockReleaseBuffer(buf);
+				buf = InvalidBuffer;
+			}
+		}
+		if (!BufferIsValid(buf))
+		{
+			buf = zsbt_descend(rel, ZS_META_ATTRIBUTE_NUM, nexttid, 0, true);
+			if (!BufferIsValid(buf))
+				break;			/* the tree doesn't exist yet */
+		}
+
+		page = BufferGetPage(buf);
+		opaque = ZSBtreePageGetOpaque(page);
+
+		maxoff = PageGetMaxOffsetNumber(page);
+		for (off = FirstOffsetNumber; off <= maxoff; off++)
+		{
+			ItemId		iid = PageGetItemId(page, off);
+			ZSTidArrayItem *item = (ZSTidArrayItem *) PageGetItem(page, iid);
+			bool		slot_dead[ZSBT_MAX_ITEM_UNDO_SLOTS];
+			int			i;
+
+			/* skip what we've seen already, if we had to re-descend */
+			if (item->t_endtid <= nexttid)
+				continue;
+
+			zsbt_tid_item_unpack(item, &iter);
+
+			/* check the visibility of each UNDO slot once */
+			slot_dead[ZSBT_OLD_UNDO_SLOT] = false;
+			slot_dead[ZSBT_DEAD_UNDO_SLOT] = true;
+			for (i = 2; i < item->t_num_undo_slots; i++)
+			{
+				ZSUndoSlotVisibility visi_info = InvalidUndoSlotVisibility;
+				TransactionId obsoleting_xid;
+
+				slot_dead[i] =
+					!zs_SatisfiesVisibility(&scan, iter.undoslots[i],
+											&obsoleting_xid, NULL, &visi_info) ||
+					visi_info.nonvacuumable_status == ZSNV_RECENTLY_DEAD;
+			}
+
+			for (i = 0; i < iter.num_tids; i++)
+			{
+				if (iter.tids[i] < nexttid)
+					continue;
+
+				if (slot_dead[iter.tid_undoslotnos[i]])
+				{
+					stat->dead_item_count++;
+					if (iter.tids[i] > lastdead)
+					{
+						if (dead->ntids >= dead->maxtids)
+						{
+							dead->maxtids *= 2;
+							dead->tids = repalloc_huge(dead->tids,
+													   dead->maxtids * sizeof(zstid));
+						}
+						dead->tids[dead->ntids++] = iter.tids[i];
+						lastdead = iter.tids[i];
+					}
+				}
+				else
+					stat->item_count++;
+			}
+
+			stat->stored_len += item->t_size;
+			stat->uncompressed_len += item->t_size;
+		}
+
+		nexttid = opaque->zs_hikey;
+		nextblock = opaque->zs_next;
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+	}
+
+	if (BufferIsValid(buf))
+		ReleaseBuffer(buf);
+}
+
+/*
+ * Decide how many parallel workers to use for the physical pass, using the
+ * same limits as a parallel sequential scan.
+ */
+static int
+pgstat_zs_compute_workers(Relation rel, BlockNumber nblocks)
+{
+	/* workers can't see our local buffers, and can't launch workers */
+	if (RelationUsesLocalBuffers(rel) || IsInParallelMode())
+		return 0;
+
+	if (nblocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	return max_parallel_workers_per_gather;
+}
+
+/*
+ * Scan the table with the help of parallel workers.  The leader takes part
+ * in the scan, and adds up the statistics of all the workers in 'stats'.
+ */
+static void
+pgstat_zs_parallel_scan(Relation rel, int nworkers, BlockNumber nblocks,
+						pgstatzedstore_dead_tids *dead,
+						pgstatzedstore_type *stats, int natts)
+{
+	ParallelContext *pcxt;
+	pgstatzedstore_shared *shared;
+	zstid	   *shared_dead;
+	Size		sharedsize;
+	Size		deadsize;
+	int			i;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("pgstattuple", "pgstatzedstore_worker",
+								 nworkers);
+
+	sharedsize = add_size(offsetof(pgstatzedstore_shared, stats),
+						  mul_size(sizeof(pgstatzedstore_type),
+								   mul_size(nworkers, natts + 1)));
+	deadsize = mul_size(sizeof(zstid), Max(dead->ntids, 1));
+	shm_toc_estimate_chunk(&pcxt->estimator, sharedsize);
+	shm_toc_estimate_chunk(&pcxt->estimator, deadsize);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	InitializeParallelDSM(pcxt);
+
+	shared = (pgstatzedstore_shared *) shm_toc_allocate(pcxt->toc, sharedsize);
+	shared->relid = RelationGetRelid(rel);
+	shared->natts = natts;
+	shared->nblocks = nblocks;
+	shared->ndead = dead->ntids;
+	pg_atomic_init_u32(&shared->nextblock, ZS_META_BLK + 1);
+	memset(shared->stats, 0,
+		   sizeof(pgstatzedstore_type) * nworkers * (natts + 1));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_PGSTATZS_SHARED, shared);
+
+	shared_dead = (zstid *) shm_toc_allocate(pcxt->toc, deadsize);
+	memcpy(shared_dead, dead->tids, sizeof(zstid) * dead->ntids);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_PGSTATZS_DEAD_TIDS, shared_dead);
+
+	LaunchParallelWorkers(pcxt);
+
+	pgstat_zs_scan_blocks(rel, &shared->nextblock, nblocks,
+						  shared_dead, dead->ntids, stats, natts);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* the slices of the workers that didn't start are all zeros */
+	for (i = 0; i < nworkers; i++)
+	{
+		pgstatzedstore_type *wstats = &shared->stats[i * (natts + 1)];
+		int			attno;
+
+		for (attno = ZS_META_ATTRIBUTE_NUM; attno <= natts; attno++)
+		{
+			stats[attno].tree_pages += wstats[attno].tree_pages;
+			stats[attno].leaf_pages += wstats[attno].leaf_pages;
+			stats[attno].free_space += wstats[attno].free_space;
+			stats[attno].item_count += wstats[attno].item_count;
+			stats[attno].dead_item_count += wstats[attno].dead_item_count;
+			stats[attno].stored_len += wstats[attno].stored_len;
+			stats[attno].uncompressed_len += wstats[attno].uncompressed_len;
+			stats[attno].toast_pages += wstats[attno].toast_pages;
+		}
+	}
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Entry point of the parallel workers.
+ */
+void
+pgstatzedstore_worker(dsm_segment *seg, shm_toc *toc)
+{
+	pgstatzedstore_shared *shared;
+	zstid	   *dead_tids;
+	Relation	rel;
+
+	shared = shm_toc_lookup(toc, PARALLEL_KEY_PGSTATZS_SHARED, false);
+	dead_tids = shm_toc_lookup(toc, PARALLEL_KEY_PGSTATZS_DEAD_TIDS, false);
+
+	/* the leader holds the same lock, so this can't block */
+	rel = relation_open(shared->relid, AccessShareLock);
+
+	pgstat_zs_scan_blocks(rel, &shared->nextblock, shared->nblocks,
+						  dead_tids, shared->ndead,
+						  &shared->stats[ParallelWorkerNumber * (shared->natts + 1)],
+						  shared->natts);
+
+	relation_close(rel, AccessShareLock);
+}
+
+/*
+ * Read blocks in physical order, claiming each one from 'nextblock', until
+ * all 'nblocks' have been read, and accumulate statistics of the pages in
+ * 'stats'.  The counters of the TID tree items were already computed by
+ * pgstat_zs_tid_tree(), so only the page counts and free space of the TID
+ * tree are added here.
+ */
+static void
+pgstat_zs_scan_blocks(Relation rel, pg_atomic_uint32 *nextblock,
+					  BlockNumber nblocks, zstid *dead_tids, uint64 ndead,
+					  pgstatzedstore_type *stats, int natts)
+{
+	BufferAccessStrategy bstrategy;
+	attstream_decoder *decoders;
+	BlockNumber blkno;
+	int			attno;
+
+	decoders = palloc0(sizeof(attstream_decoder) * (natts + 1));
+	for (attno = 1; attno <= natts; attno++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), attno - 1);
+
+		init_attstream_decoder(&decoders[attno], attr->attbyval, attr->attlen);
+	}
+
+	bstrategy = GetAccessStrategy(BAS_BULKREAD);
+
+	while ((blkno = pg_atomic_fetch_add_u32(nextblock, 1)) < nblocks)
+	{
+		Buffer		buf;
+		Page		page;
+
+		CHECK_FOR_INTERRUPTS();
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 bstrategy);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+
+		if (PageIsNew(page))
+		{
+			/* an all-zeros page, not yet in use */
+		}
+		else if (PageGetSpecialSize(page) == MAXALIGN(sizeof(ZSBtreePageOpaque)) &&
+				 ZSBtreePageGetOpaque(page)->zs_page_id == ZS_BTREE_PAGE_ID)
+		{
+			ZSBtreePageOpaque *opaque = ZSBtreePageGetOpaque(page);
+			pgstatzedstore_type *stat;
+
+			if (opaque->zs_attno < ZS_META_ATTRIBUTE_NUM ||
+				opaque->zs_attno > natts)
+			{
+				UnlockReleaseBuffer(buf);
+				continue;
+			}
+			stat = &stats[opaque->zs_attno];
+
+			stat->tree_pages++;
+			stat->free_space += PageGetExactFreeSpace(page);
+
+			if (opaque->zs_level == 0)
+			{
+				stat->leaf_pages++;
+
+				/* the TID tree leaves were already counted */
+				if (opaque->zs_attno != ZS_META_ATTRIBUTE_NUM)
+				{
+					PageHeader	phdr = (PageHeader) page;
+					int			lowersize;
+					int			uppersize;
+
+					/* uncompressed stream after the header */
+					lowersize = phdr->pd_lower - SizeOfPageHeaderData;
+					if (lowersize > SizeOfZSAttStreamHeader)
+						pgstat_zs_attstream((ZSAttStream *) ((char *) page + SizeOfPageHeaderData),
+											&decoders[opaque->zs_attno],
+											dead_tids, ndead, stat);
+
+					/* compressed stream before the special area */
+					uppersize = phdr->pd_special - phdr->pd_upper;
+					if (uppersize > SizeOfZSAttStreamHeader)
+						pgstat_zs_attstream((ZSAttStream *) ((char *) page + phdr->pd_upper),
+											&decoders[opaque->zs_attno],
+											dead_tids, ndead, stat);
+				}
+			}
+		}
+		else if (PageGetSpecialSize(page) == MAXALIGN(sizeof(ZSToastPageOpaque)) &&
+				 ((ZSToastPageOpaque *) PageGetSpecialPointer(page))->zs_page_id == ZS_TOAST_PAGE_ID)
+		{
+			ZSToastPageOpaque *opaque;
+
+			opaque = (ZSToastPageOpaque *) PageGetSpecialPointer(page);
+			if (opaque->zs_attno > ZS_META_ATTRIBUTE_NUM &&
+				opaque->zs_attno <= natts)
+				stats[opaque->zs_attno].toast_pages++;
+		}
+
+		UnlockReleaseBuffer(buf);
+	}
+
+	for (attno = 1; attno <= natts; attno++)
+		destroy_attstream_decoder(&decoders[attno]);
+	pfree(decoders);
+	FreeAccessStrategy(bstrategy);
+}
+
+/*
+ * Count the values in one attribute stream, and its size.
+ */
+static void
+pgstat_zs_attstream(ZSAttStream *stream, attstream_decoder *decoder,
+					zstid *dead_tids, uint64 ndead, pgstatzedstore_type *stat)
+{
+	stat->stored_len += stream->t_size;
+	if ((stream->t_flags & ATTSTREAM_COMPRESSED) != 0)
+		stat->uncompressed_len += SizeOfZSAttStreamHeader +
+			stream->t_decompressed_size;
+	else
+		stat->uncompressed_len += stream->t_size;
+
+	decode_attstream_begin(decoder, stream);
+	while (decode_attstream_cont(decoder))
+	{
+		int			i;
+
+		for (i = 0; i < decoder->num_elements; i++)
+		{
+			if (pgstat_zs_tid_is_dead(decoder->tids[i], dead_tids, ndead))
+				stat->dead_item_count++;
+			else
+				stat->item_count++;
+		}
+	}
+}
+
+/*
+ * Binary search for a TID in the sorted array of dead TIDs.
+ */
+static bool
+pgstat_zs_tid_is_dead(zstid tid, zstid *dead_tids, uint64 ndead)
+{
+	uint64		lo = 0;
+	uint64		hi = ndead;
+
+	while (lo < hi)
+	{
+		uint64		mid = lo + (hi - lo) / 2;
+
+		if (dead_tids[mid] < tid)
+			lo = mid + 1;
+		else if (dead_tids[mid] > tid)
+			hi = mid;
+		else
+			return true;
+	}
+	return false;
+}
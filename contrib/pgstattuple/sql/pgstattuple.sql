@@ -117,3 +117,30 @@ drop view test_view;
 drop foreign table test_foreign_table;
 drop server dummy_server;
 drop foreign data wrapper dummy;
+
+--
+-- zedstore tables
+--
+create table test_zs (a int, b text) using zedstore
+  with (autovacuum_enabled = off);
+select * from pgstatzedstore('test_zs');
+insert into test_zs select i, 'row ' || i from generate_series(1, 1000) i;
+select attno, tree_pages > 0 as has_pages, item_count, dead_item_count,
+       toast_pages
+  from pgstatzedstore('test_zs');
+-- deleted rows, and rows inserted by an aborted transaction, are dead
+delete from test_zs where a % 4 = 0;
+begin;
+insert into test_zs select i, 'row ' || i from generate_series(1001, 1100) i;
+select count(*) from test_zs;
+rollback;
+select attno, item_count, dead_item_count from pgstatzedstore('test_zs');
+-- the same, with parallel workers
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+select attno, item_count, dead_item_count from pgstatzedstore('test_zs');
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+-- not for other tables
+select * from pgstatzedstore('test');
+drop table test_zs;
@@ -116,6 +116,7 @@ typedef struct deparse_expr_cxt
 static bool foreign_expr_walker(Node *node,
 								foreign_glob_cxt *glob_cxt,
 								foreign_loc_cxt *outer_cxt);
+static bool partial_agg_ok(Aggref *agg);
 static char *deparse_type_name(Oid type_oid, int32 typemod);
 
 /*
@@ -683,8 +684,14 @@ foreign_expr_walker(Node *node,
 				if (!IS_UPPER_REL(glob_cxt->foreignrel))
 					return false;
 
-				/* Only non-split aggregates are pushable. */
-				if (agg->aggsplit != AGGSPLIT_SIMPLE)
+				/*
+				 * Only non-split aggregates are pushable, except that the
+				 * partial phase of an aggregate can be evaluated remotely
+				 * when its transition state is also its result.
+				 */
+				if (agg->aggsplit != AGGSPLIT_SIMPLE &&
+					!(agg->aggsplit == AGGSPLIT_INITIAL_SERIAL &&
+					  partial_agg_ok(agg)))
 					return false;
 
 				/* As usual, it must be shippable. */
@@ -839,6 +846,39 @@ foreign_expr_walker(Node *node,
 	return true;
 }
 
+/*
+ * Check whether the partial (non-finalized) result of the given aggregate can
+ * be computed by running the aggregate itself on the foreign server.
+ *
+ * That holds for aggregates without a final function, such as count(), sum()
+ * over integer types, min() and max(): their result is the transition state,
+ * which the local Finalize Aggregate node combines with the aggregate's
+ * combine function.  Aggregates with a final function or an "internal" state,
+ * such as avg(), have no SQL-level representation of their state and are not
+ * pushed down in partial mode.
+ */
+static bool
+partial_agg_ok(Aggref *agg)
+{
+	HeapTuple	aggtup;
+	Form_pg_aggregate aggform;
+	bool		result;
+
+	aggtup = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(agg->aggfnoid));
+	if (!HeapTupleIsValid(aggtup))
+		elog(ERROR, "cache lookup failed for aggregate %u", agg->aggfnoid);
+	aggform = (Form_pg_aggregate) GETSTRUCT(aggtup);
+
+	result = (aggform->aggkind == AGGKIND_NORMAL &&
+			  !OidIsValid(aggform->aggfinalfn) &&
+			  OidIsValid(aggform->aggcombinefn) &&
+			  aggform->aggtranstype != INTERNALOID);
+
+	ReleaseSysCache(aggtup);
+
+	return result;
+}
+
 /*
  * Returns true if given expr is something we'd have to send the value of
  * to the foreign server.
@@ -1683,14 +1723,16 @@ deparseRangeTblRef(StringInfo buf, PlannerInfo *root, RelOptInfo *foreignrel,
  *
  * The statement text is appended to buf, and we also create an integer List
  * of the columns being retrieved by WITH CHECK OPTION or RETURNING (if any),
- * which is returned to *retrieved_attrs.
+ * which is returned to *retrieved_attrs.  The length of the statement up to
+ * the end of the VALUES clause is returned to *values_end_len, for use by
+ * rebuildInsertSql().
  */
 void
 deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 				 Index rtindex, Relation rel,
 				 List *targetAttrs, bool doNothing,
 				 List *withCheckOptionList, List *returningList,
-				 List **retrieved_attrs)
+				 List **retrieved_attrs, int *values_end_len)
 {
 	AttrNumber	pindex;
 	bool		first;
@@ -1733,6 +1775,7 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 	}
 	else
 		appendStringInfoString(buf, " DEFAULT VALUES");
+	*values_end_len = buf->len;
 
 	if (doNothing)
 		appendStringInfoString(buf, " ON CONFLICT DO NOTHING");
@@ -1742,6 +1785,57 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 						 withCheckOptionList, returningList, retrieved_attrs);
 }
 
+/*
+ * rebuild remote INSERT statement
+ *
+ * Given the statement deparsed by deparseInsertSql() for a single row,
+ * build one that inserts 'num_rows' rows.  'values_end_len' is the length of
+ * the original statement up to the end of its VALUES clause, and
+ * 'num_params' is the number of parameters per row.
+ */
+void
+rebuildInsertSql(StringInfo buf, char *orig_query,
+				 int values_end_len, int num_params,
+				 int num_rows)
+{
+	int			i,
+				j;
+	int			pindex;
+	bool		first;
+
+	/* Make sure the values_end_len is sensible */
+	Assert((values_end_len > 0) && (values_end_len <= strlen(orig_query)));
+
+	/* Copy up to the end of the first record from the original query */
+	appendBinaryStringInfo(buf, orig_query, values_end_len);
+
+	/*
+	 * Add records to VALUES clause (we already have parameters for the first
+	 * row, so start at the right offset).
+	 */
+	pindex = num_params + 1;
+	for (i = 1; i < num_rows; i++)
+	{
+		appendStringInfoString(buf, ", (");
+
+		first = true;
+		for (j = 0; j < num_params; j++)
+		{
+			if (!first)
+				appendStringInfoString(buf, ", ");
+			first = false;
+
+			appendStringInfo(buf, "$%d", pindex);
+			pindex++;
+		}
+
+		appendStringInfoChar(buf, ')');
+	}
+
+	/* Copy stuff after VALUES clause from the original query */
+	appendStringInfoString(buf, orig_query + values_end_len);
+}
+
 /*
  * deparse remote UPDATE statement
  *
@@ -2941,8 +3035,12 @@ deparseAggref(Aggref *node, deparse_expr_cxt *context)
 	StringInfo	buf = context->buf;
 	bool		use_variadic;
 
-	/* Only basic, non-split aggregation accepted. */
-	Assert(node->aggsplit == AGGSPLIT_SIMPLE);
+	/*
+	 * Only basic aggregation, or the partial phase of an aggregate whose
+	 * state is its result, is accepted; see partial_agg_ok().
+	 */
+	Assert(node->aggsplit == AGGSPLIT_SIMPLE ||
+		   node->aggsplit == AGGSPLIT_INITIAL_SERIAL);
 
 	/* Check if need to print VARIADIC (cf. ruleutils.c) */
 	use_variadic = node->aggvariadic;
@@ -120,6 +120,7 @@ typedef struct LVRelStats
 	BlockNumber scanned_pages;	/* number of pages we examined */
 	BlockNumber pinskipped_pages;	/* # of pages we skipped due to a pin */
 	BlockNumber frozenskipped_pages;	/* # of frozen pages we skipped */
+	BlockNumber eagerfrozen_pages;	/* # of pages frozen ahead of FreezeLimit */
 	BlockNumber tupcount_pages; /* pages whose tuples we counted */
 	double		old_live_tuples;	/* previous value of pg_class.reltuples */
 	double		new_rel_tuples; /* new estimated total # of tuples */
@@ -155,6 +156,11 @@ static void lazy_scan_heap(Relation onerel, VacuumParams *params,
 						   bool aggressive);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup);
+static int	lazy_prepare_eager_freeze(Page page,
+									  TransactionId relfrozenxid,
+									  MultiXactId relminmxid,
+									  xl_heap_freeze_tuple *frozen,
+									  bool *all_frozen);
 static void lazy_vacuum_index(Relation indrel,
 							  IndexBulkDeleteResult **stats,
 							  LVRelStats *vacrelstats);
@@ -205,6 +211,7 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	MultiXactId mxactFullScanLimit;
 	BlockNumber new_rel_pages;
 	BlockNumber new_rel_allvisible;
+	BlockNumber new_rel_allfrozen;
 	double		new_live_tuples;
 	TransactionId new_frozen_xid;
 	MultiXactId new_min_multi;
@@ -346,9 +353,11 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 		new_live_tuples = vacrelstats->old_live_tuples;
 	}
 
-	visibilitymap_count(onerel, &new_rel_allvisible, NULL);
+	visibilitymap_count(onerel, &new_rel_allvisible, &new_rel_allfrozen);
 	if (new_rel_allvisible > new_rel_pages)
 		new_rel_allvisible = new_rel_pages;
+	if (new_rel_allfrozen > vacrelstats->rel_pages)
+		new_rel_allfrozen = vacrelstats->rel_pages;
 
 	new_frozen_xid = scanned_all_unfrozen ? FreezeLimit : InvalidTransactionId;
 	new_min_multi = scanned_all_unfrozen ? MultiXactCutoff : InvalidMultiXactId;
@@ -421,6 +430,9 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 							 vacrelstats->rel_pages,
 							 vacrelstats->pinskipped_pages,
 							 vacrelstats->frozenskipped_pages);
+			appendStringInfo(&buf, _("frozen pages: %u frozen eagerly, %u not yet all-frozen\n"),
+							 vacrelstats->eagerfrozen_pages,
+							 vacrelstats->rel_pages - new_rel_allfrozen);
 			appendStringInfo(&buf,
 							 _("tuples: %.0f removed, %.0f remain, %.0f are dead but not yet removable, oldest xmin: %u\n"),
 							 vacrelstats->tuples_deleted,
@@ -645,6 +657,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 					hastup;
 		int			prev_dead_count;
 		int			nfrozen;
+		int			npruned;
+		TransactionId freeze_cutoff = FreezeLimit;
 		Size		freespace;
 		bool		all_visible_according_to_vm = false;
 		bool		all_visible;
@@ -974,8 +988,9 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 *
 		 * We count tuples removed by the pruning step as removed by VACUUM.
 		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
-										 &vacrelstats->latestRemovedXid);
+		npruned = heap_page_prune(onerel, buf, OldestXmin, false,
+								  &vacrelstats->latestRemovedXid);
+		tups_vacuumed += npruned;
 
 		/*
 		 * Now scan the page to collect vacuumable items and check for tuples
@@ -1199,6 +1214,37 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			}
 		}						/* scan along page */
 
+		/*
+		 * If every tuple on the page is visible to everyone, but some are not
+		 * old enough to be frozen yet, consider freezing the whole page right
+		 * away, so that it can be marked all-frozen and skipped by future
+		 * aggressive vacuums.  Otherwise an append-only table gets read and
+		 * written all over again by the anti-wraparound vacuum, long after
+		 * it was loaded.  Only do it if we are dirtying the page anyway:
+		 * because we are freezing some of its tuples, because pruning
+		 * modified it, or because it is about to be marked all-visible.
+		 */
+		if (vacuum_eager_freeze && all_visible && !all_frozen &&
+			(nfrozen > 0 || npruned > 0 || !all_visible_according_to_vm))
+		{
+			nfrozen = lazy_prepare_eager_freeze(page, relfrozenxid,
+												relminmxid, frozen,
+												&all_frozen);
+			if (all_frozen)
+				vacrelstats->eagerfrozen_pages++;
+
+			/*
+			 * Every xid we freeze is now at most the newest xmin on the page,
+			 * so that is what standby queries need to conflict with, rather
+			 * than OldestXmin.  The WAL record carries the first xid that
+			 * was not frozen.
+			 */
+			freeze_cutoff = visibility_cutoff_xid;
+			TransactionIdAdvance(freeze_cutoff);
+			if (TransactionIdPrecedes(freeze_cutoff, FreezeLimit))
+				freeze_cutoff = FreezeLimit;
+		}
+
 		/*
 		 * If we froze any tuples, mark the buffer dirty, and write a WAL
 		 * record recording the changes.  We must log the changes to be
@@ -1227,7 +1273,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			{
 				XLogRecPtr	recptr;
 
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
+				recptr = log_heap_freeze(onerel, buf, freeze_cutoff,
 										 frozen, nfrozen);
 				PageSetLSN(page, recptr);
 			}
@@ -1495,6 +1541,10 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 									"%u frozen pages.\n",
 									vacrelstats->frozenskipped_pages),
 					 vacrelstats->frozenskipped_pages);
+	appendStringInfo(&buf, ngettext("%u page frozen eagerly.\n",
+									"%u pages frozen eagerly.\n",
+									vacrelstats->eagerfrozen_pages),
+					 vacrelstats->eagerfrozen_pages);
 	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
 									"%u pages are entirely empty.\n",
 									empty_pages),
@@ -1678,6 +1728,53 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	return tupindex;
 }
 
+/*
+ *	lazy_prepare_eager_freeze() -- prepare to freeze all tuples on a page
+ *
+ * The caller has established that every tuple on the page is visible to
+ * everyone, so each of them can be frozen using OldestXmin as the cutoff,
+ * rather than FreezeLimit.  Fills 'frozen' with the freeze plans and returns
+ * how many there are.  *all_frozen is set if the page will be all-frozen
+ * afterwards (a tuple might be locked by a multixact that is still needed,
+ * for example).
+ */
+static int
+lazy_prepare_eager_freeze(Page page, TransactionId relfrozenxid,
+						  MultiXactId relminmxid, xl_heap_freeze_tuple *frozen,
+						  bool *all_frozen)
+{
+	OffsetNumber offnum,
+				maxoff;
+	int			nfrozen = 0;
+
+	*all_frozen = true;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		bool		tuple_totally_frozen;
+
+		/* an all-visible page has no dead items; skip unused and redirects */
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		if (heap_prepare_freeze_tuple((HeapTupleHeader) PageGetItem(page, itemid),
+									  relfrozenxid, relminmxid,
+									  OldestXmin, MultiXactCutoff,
+									  &frozen[nfrozen],
+									  &tuple_totally_frozen))
+			frozen[nfrozen++].offset = offnum;
+
+		if (!tuple_totally_frozen)
+			*all_frozen = false;
+	}
+
+	return nfrozen;
+}
+
 /*
  *	lazy_check_needs_freeze() -- scan page to see if any tuples
  *					 need to be cleaned to avoid wraparound
@@ -775,6 +775,7 @@ SetParallelStartTimestamps(TimestampTz xact_ts, TimestampTz stmt_ts)
 	Assert(IsParallelWorker());
 	xactStartTimestamp = xact_ts;
 	stmtStartTimestamp = stmt_ts;
+	SetCatCacheClock(stmt_ts);
 }
 
 /*
@@ -822,6 +823,9 @@ SetCurrentStatementStartTimestamp(void)
 		stmtStartTimestamp = GetCurrentTimestamp();
 	else
 		Assert(stmtStartTimestamp != 0);
+
+	/* Catcache entry ages are measured in statements' start times */
+	SetCatCacheClock(stmtStartTimestamp);
 }
 
 /*
@@ -7332,8 +7332,13 @@ StartupXLOG(void)
 	 * end-of-recovery steps fail.
 	 */
 	if (InRecovery)
+	{
 		ResetUnloggedRelations(UNLOGGED_RELATION_INIT);
 
+		/* The main forks were copied outside smgr, forget their sizes */
+		smgrdropdbsizes(InvalidOid);
+	}
+
 	/*
 	 * We don't need the latch anymore. It's not strictly necessary to disown
 	 * it, but let's do it for the sake of tidiness.
@@ -356,6 +356,63 @@ zsbt_attr_remove(Relation rel, AttrNumber attno, IntegerSet *tids)
 	MemoryContextDelete(tmpcontext);
 }
 
+/*
+ * Recompress an attribute leaf page image, in place.
+ *
+ * Uncompressed data that has been appended to the page since it was last
+ * repacked (the "lower" stream) is merged with the compressed data, and the
+ * result is compressed again. This is only done if everything still fits on
+ * the page, so the range of TIDs on the page, and on all other pages, stays
+ * the same. That makes this usable on page images that are being copied
+ * outside the buffer manager, like in relation_copy_data.
+ *
+ * Returns true if the page was modified.
+ */
+bool
+zsbt_attr_recompress_page(Form_pg_attribute attr, Page page)
+{
+	ZSAttStream *lowerstream;
+	ZSAttStream *upperstream;
+	attstream_buffer attbuf;
+	Page		newpage;
+	bool		modified = false;
+
+	lowerstream = get_page_lowerstream(page);
+	upperstream = get_page_upperstream(page);
+
+	/* Nothing to do, if all the data is already compressed */
+	if (lowerstream == NULL)
+		return false;
+
+	if (upperstream)
+		init_attstream_buffer_from_stream(&attbuf, attr->attbyval, attr->attlen,
+										  upperstream, CurrentMemoryContext);
+	else
+		init_attstream_buffer(&attbuf, attr->attbyval, attr->attlen);
+	merge_attstream(attr, &attbuf, lowerstream);
+
+	newpage = PageGetTempPageCopySpecial(page);
+	zsbt_attr_pack_attstream(attr, &attbuf, newpage);
+
+	/*
+	 * Use the result only if all the data fit, and it was compressed. (If
+	 * compression failed, zsbt_attr_pack_attstream() stored it in the lower
+	 * stream instead, and we gained nothing.)
+	 */
+	if (attbuf.cursor == attbuf.len &&
+		((PageHeader) newpage)->pd_lower == SizeOfPageHeaderData)
+	{
+		PageSetLSN(newpage, PageGetLSN(page));
+		memcpy(page, newpage, BLCKSZ);
+		modified = true;
+	}
+
+	pfree(newpage);
+	pfree(attbuf.data);
+
+	return modified;
+}
+
 /* ----------------------------------------------------------------
  *						 Internal routines
  * ----------------------------------------------------------------
@@ -39,7 +39,8 @@ static int zsbt_binsrch_internal(zstid key, ZSBtreeInternalPageItem *arr, int ar
 /*
  * Find the page containing the given key TID at the given level.
  *
- * Level 0 means leaf. The returned buffer is exclusive-locked.
+ * Level 0 means leaf. The returned buffer is exclusive-locked, or
+ * share-locked if 'readonly' is true.
  *
  * If tree doesn't exist at all (probably because the table was just created
  * or truncated), the behavior depends on the 'readonly' argument. If
@@ -57,8 +58,10 @@ zsbt_descend(Relation rel, AttrNumber attno, zstid key, int level, bool readonly
 	int			nitems;
 	int			itemno;
 	int			nextlevel;
+	int			lockmode;
 	BlockNumber failblk = InvalidBlockNumber;
 	int			faillevel = -1;
+	bool		from_rightmost = false;
 	ZSMetaCacheData *metacache;
 
 	Assert(key != InvalidZSTid);
@@ -72,6 +75,7 @@ zsbt_descend(Relation rel, AttrNumber attno, zstid key, int level, bool readonly
 	{
 		next = metacache->cache_attrs[attno].rightmost;
 		nextlevel = 0;
+		from_rightmost = true;
 	}
 	else
 	{
@@ -97,8 +101,21 @@ zsbt_descend(Relation rel, AttrNumber attno, zstid key, int level, bool readonly
 		if (next == failblk || next == ZS_META_BLK)
 			elog(ERROR, "arrived at incorrect block %u while descending zedstore btree", next);
 
+		/*
+		 * Internal pages are only read to find the downlink to follow, so a
+		 * shared lock is enough for them, and concurrent descents don't
+		 * serialize on the upper levels.  The page at the target level is
+		 * locked exclusively, unless the caller only needs to read it.  If we
+		 * don't know the level of the page yet, because we're starting from
+		 * the root, lock it in shared mode and upgrade below if needed.
+		 */
+		if (nextlevel == level && !readonly)
+			lockmode = BUFFER_LOCK_EXCLUSIVE;
+		else
+			lockmode = BUFFER_LOCK_SHARE;
+
 		buf = ReadBuffer(rel, next);
-		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);		/* TODO: shared */
+		LockBuffer(buf, lockmode);
 		page = BufferGetPage(buf);
 		if (!zsbt_page_is_expected(rel, attno, key, nextlevel, buf))
 		{
@@ -114,9 +131,29 @@ zsbt_descend(Relation rel, AttrNumber attno, zstid key, int level, bool readonly
 			 */
 			UnlockReleaseBuffer(buf);
 
+			if (from_rightmost)
+			{
+				/*
+				 * The cached rightmost leaf was split. That happens all the
+				 * time when appending, and the cached root is still good, so
+				 * just forget the rightmost page and descend from the root.
+				 * We'll remember the new rightmost page when we reach it.
+				 */
+				from_rightmost = false;
+				metacache = zsmeta_get_cache(rel);
+				if (attno < metacache->cache_nattributes)
+					metacache->cache_attrs[attno].rightmost = InvalidBlockNumber;
+				nextlevel = -1;
+				next = zsmeta_get_root_for_attribute(rel, attno, readonly);
+				if (next == InvalidBlockNumber)
+					elog(ERROR, "could not find root for attribute %d", attno);
+				continue;
+			}
+
 			failblk = next;
 			faillevel = nextlevel;
 			nextlevel = -1;
+			zsmeta_invalidate_shared_cache(rel);
 			zsmeta_invalidate_cache(rel);
 			next = zsmeta_get_root_for_attribute(rel, attno, readonly);
 			if (next == InvalidBlockNumber)
@@ -146,7 +183,29 @@ zsbt_descend(Relation rel, AttrNumber attno, zstid key, int level, bool readonly
 			elog(ERROR, "unexpected level encountered when descending tree");
 
 		if (opaque->zs_level == level)
-			break;
+		{
+			if (readonly || lockmode == BUFFER_LOCK_EXCLUSIVE)
+				break;
+
+			/*
+			 * This is the root, and it is also the page the caller wants to
+			 * modify.  Re-lock it in exclusive mode.  The page can be split
+			 * while it's unlocked, so check it again.  It doesn't matter if
+			 * it's not the root anymore, as long as it still covers the key.
+			 */
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+			if (zsbt_page_is_expected(rel, attno, key, level, buf))
+				break;
+
+			/* It was changed under us. Start over from the (new) root. */
+			UnlockReleaseBuffer(buf);
+			nextlevel = -1;
+			next = zsmeta_get_root_for_attribute(rel, attno, readonly);
+			if (next == InvalidBlockNumber)
+				elog(ERROR, "could not find root for attribute %d", attno);
+			continue;
+		}
 
 		/* Find the downlink and follow it */
 		items = ZSBtreeInternalPageGetItems(page);
@@ -166,10 +225,12 @@ zsbt_descend(Relation rel, AttrNumber attno, zstid key, int level, bool readonly
 	if (opaque->zs_level == 0 && opaque->zs_next == InvalidBlockNumber)
 	{
 		metacache = zsmeta_get_cache(rel);
-		if (attno < metacache->cache_nattributes)
+		if (attno < metacache->cache_nattributes &&
+			metacache->cache_attrs[attno].rightmost != next)
 		{
 			metacache->cache_attrs[attno].rightmost = next;
 			metacache->cache_attrs[attno].rightmost_lokey = opaque->zs_lokey;
+			zsmeta_update_shared_rightmost(rel, attno, next, opaque->zs_lokey);
 		}
 	}
 
@@ -183,6 +244,9 @@ zsbt_descend(Relation rel, AttrNumber attno, zstid key, int level, bool readonly
  * If 'buf' is valid, it is a previously pinned page. We will check that
  * page first. If it's not the correct page, it will be released.
  *
+ * Only shared locking is supported, since we descend the tree in read-only
+ * mode if the old page cannot be used.
+ *
  * Returns InvalidBuffer, if the attribute tree doesn't exist at all.
  * That should only happen after ALTER TABLE ADD COLUMN. Or on a newly
  * created table, but none of the current callers would even try to
@@ -192,6 +256,8 @@ Buffer
 zsbt_find_and_lock_leaf_containing_tid(Relation rel, AttrNumber attno,
 									   Buffer buf, zstid nexttid, int lockmode)
 {
+	Assert(lockmode == BUFFER_LOCK_SHARE);
+
 	if (BufferIsValid(buf))
 	{
 retry:
@@ -356,6 +422,12 @@ zsbt_newroot(Relation rel, AttrNumber attno, int level, List *downlinks)
 
 	metapg->tree_root_dir[attno].root = BufferGetBlockNumber(newrootbuf);
 
+	/*
+	 * The metapage stays locked until the split is applied, so any backend
+	 * that reads the metapage after this will see the new root.
+	 */
+	zsmeta_invalidate_shared_cache(rel);
+
 	stack1 = zs_new_split_stack_entry(metabuf, metapage);
 	stack2 = zs_new_split_stack_entry(newrootbuf, newrootpage);
 	stack2->next = stack1;
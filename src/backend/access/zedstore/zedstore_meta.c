@@ -5,6 +5,10 @@
  * The metapage holds a directory of B-tree root block numbers, one for each
  * column.
  *
+ * Each backend keeps a copy of the root directory in rel->rd_amcache, and
+ * there is also a copy in shared memory, for the benefit of backends that
+ * need to rebuild their private copy. See "Shared metapage cache" below.
+ *
  * TODO:
  * - extend the root block dir to an overflow page if there are too many
  *   attributes to fit on one page
@@ -18,17 +22,354 @@
 #include "postgres.h"
 
 #include "access/itup.h"
+#include "access/xlog.h"
 #include "access/xlogutils.h"
+#include "access/zedstoream.h"
 #include "access/zedstore_internal.h"
 #include "access/zedstore_wal.h"
 #include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
+/*
+ * Shared metapage cache
+ * ---------------------
+ *
+ * The backend-private ZSMetaCacheData is thrown away on every smgr
+ * invalidation, and whenever a tree descent lands on an unexpected page.
+ * Rebuilding it used to require reading and locking the metapage, and
+ * checking the relation size, so after an invalidation storm all backends
+ * would queue up on the metapage. To avoid that, the root directory and the
+ * rightmost leaf of each tree are also published in a shared hash table,
+ * keyed by relfilenode, from which backends rebuild their private copies.
+ *
+ * The information in the shared cache is just a hint, like the private
+ * copy: every page reached through it is verified with zsbt_page_is_expected(),
+ * and if the check fails, the shared entry is invalidated, so that the next
+ * backend to need it reads the metapage again. An entry is also invalidated
+ * whenever the metapage's root directory changes.
+ *
+ * Each entry has a change counter that is changed on invalidation. A backend
+ * that misses in the cache notes the counter before reading the metapage,
+ * and publishes what it read only if the counter hasn't moved in between.
+ * The counter values are taken from a single generation counter, shared by
+ * all entries, so that an entry that is evicted and created again never
+ * gets a value that a backend might have noted from its earlier incarnation.
+ * Otherwise the root directory might have changed after we read it, and we
+ * would publish stale information.
+ *
+ * Temporary relations are not cached, because their relfilenodes are not
+ * unique across backends. Neither are relations with more attributes than
+ * fit in an entry. The cache is not used during recovery, because WAL replay
+ * doesn't maintain it.
+ *
+ * Entries for dropped relations are not removed, but when a new relfilenode
+ * is created any stale entry for it is forgotten, and when the table is full,
+ * an arbitrary entry is evicted to make room.
+ *
+ * Locking follows pg_stat_statements: ZSMetaCacheLock protects the hash
+ * table itself, and is only taken in exclusive mode to insert or evict
+ * entries. Looking up an entry needs only a shared lock, and the contents
+ * of an entry are protected by its spinlock, so that backends inserting
+ * into different (or the same) tables don't serialize on the cache.
+ */
+#define ZS_SHARED_METACACHE_SIZE		1024
+#define ZS_SHARED_METACACHE_MAX_ATTS	64
+
+typedef struct ZSSharedMetaCacheAttr
+{
+	BlockNumber root;				/* root of the b-tree */
+	BlockNumber rightmost;			/* right most leaf page */
+	zstid		rightmost_lokey;	/* lokey of rightmost leaf */
+} ZSSharedMetaCacheAttr;
+
+typedef struct ZSSharedMetaCacheEntry
+{
+	RelFileNode rnode;			/* hash key */
+
+	slock_t		mutex;			/* protects the fields below */
+	uint64		change_count;	/* new generation whenever invalidated */
+	bool		valid;			/* does 'attrs' contain valid information? */
+	int			nattributes;
+
+	ZSSharedMetaCacheAttr attrs[ZS_SHARED_METACACHE_MAX_ATTS];
+} ZSSharedMetaCacheEntry;
+
+static HTAB *ZSSharedMetaCache = NULL;
+static pg_atomic_uint64 *ZSSharedMetaCacheGeneration = NULL;
+
 static void zsmeta_wal_log_metapage(Buffer buf, int natts);
 
+Size
+ZSMetaCacheShmemSize(void)
+{
+	return add_size(hash_estimate_size(ZS_SHARED_METACACHE_SIZE,
+									   sizeof(ZSSharedMetaCacheEntry)),
+					sizeof(pg_atomic_uint64));
+}
+
+void
+ZSMetaCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	ZSSharedMetaCacheGeneration = (pg_atomic_uint64 *)
+		ShmemInitStruct("ZedStore metapage cache generation",
+						sizeof(pg_atomic_uint64), &found);
+	if (!found)
+		pg_atomic_init_u64(ZSSharedMetaCacheGeneration, 0);
+
+	info.keysize = sizeof(RelFileNode);
+	info.entrysize = sizeof(ZSSharedMetaCacheEntry);
+
+	ZSSharedMetaCache = ShmemInitHash("ZedStore metapage cache",
+									  ZS_SHARED_METACACHE_SIZE,
+									  ZS_SHARED_METACACHE_SIZE,
+									  &info,
+									  HASH_ELEM | HASH_BLOBS);
+}
+
+static bool
+zsmeta_shared_cache_usable(Relation rel)
+{
+	return !RelationUsesLocalBuffers(rel) &&
+		RelationGetNumberOfAttributes(rel) + 1 <= ZS_SHARED_METACACHE_MAX_ATTS &&
+		!RecoveryInProgress();
+}
+
+/*
+ * Find or create the shared entry for a relation. Caller must hold
+ * ZSMetaCacheLock in exclusive mode. If the table is full, evicts another
+ * entry to make room.
+ *
+ * A shared hash table treats its size only as a hint, and would keep
+ * growing into the shared memory slack, so we must enforce the limit
+ * ourselves before entering a new entry.
+ */
+static ZSSharedMetaCacheEntry *
+zsmeta_shared_cache_enter(const RelFileNode *rnode)
+{
+	ZSSharedMetaCacheEntry *entry;
+	bool		found;
+
+	entry = hash_search(ZSSharedMetaCache, rnode, HASH_FIND, NULL);
+	if (entry)
+		return entry;
+
+	if (hash_get_num_entries(ZSSharedMetaCache) >= ZS_SHARED_METACACHE_SIZE)
+	{
+		HASH_SEQ_STATUS status;
+		ZSSharedMetaCacheEntry *victim;
+
+		hash_seq_init(&status, ZSSharedMetaCache);
+		victim = hash_seq_search(&status);
+		Assert(victim != NULL);
+		hash_seq_term(&status);
+		hash_search(ZSSharedMetaCache, &victim->rnode, HASH_REMOVE, NULL);
+	}
+
+	entry = hash_search(ZSSharedMetaCache, rnode, HASH_ENTER, &found);
+	Assert(!found);
+	SpinLockInit(&entry->mutex);
+	entry->change_count = pg_atomic_add_fetch_u64(ZSSharedMetaCacheGeneration, 1);
+	entry->valid = false;
+	entry->nattributes = 0;
+
+	return entry;
+}
+
+/*
+ * Try to build the backend-private cache from the shared cache.
+ *
+ * Returns NULL on a cache miss. In that case, *change_count is set to the
+ * current change counter of the entry, which should be passed to
+ * zsmeta_publish_shared_cache() after reading the metapage.
+ */
+static ZSMetaCacheData *
+zsmeta_populate_cache_from_shared(Relation rel, uint64 *change_count)
+{
+	ZSSharedMetaCacheEntry *entry;
+	ZSSharedMetaCacheAttr attrs[ZS_SHARED_METACACHE_MAX_ATTS];
+	ZSMetaCacheData *cache;
+	bool		found;
+	int			natts = 0;
+
+	LWLockAcquire(ZSMetaCacheLock, LW_SHARED);
+	entry = hash_search(ZSSharedMetaCache, &rel->rd_node, HASH_FIND, NULL);
+	found = (entry != NULL);
+	if (entry)
+	{
+		/* copy the entry while holding the spinlock, build the cache later */
+		SpinLockAcquire(&entry->mutex);
+		if (entry->valid)
+		{
+			natts = entry->nattributes;
+			for (int i = 0; i < natts; i++)
+				attrs[i] = entry->attrs[i];
+		}
+		*change_count = entry->change_count;
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(ZSMetaCacheLock);
+
+	if (natts > 0)
+	{
+		cache = MemoryContextAllocZero(CacheMemoryContext,
+									   offsetof(ZSMetaCacheData, cache_attrs[natts]));
+		cache->cache_nattributes = natts;
+		for (int i = 0; i < natts; i++)
+		{
+			cache->cache_attrs[i].root = attrs[i].root;
+			cache->cache_attrs[i].rightmost = attrs[i].rightmost;
+			cache->cache_attrs[i].rightmost_lokey = attrs[i].rightmost_lokey;
+		}
+		return cache;
+	}
+
+	if (found)
+		return NULL;
+
+	/*
+	 * Cache miss, and no entry yet. Create it, so that any invalidation from
+	 * now on is recorded in its change counter.
+	 */
+	LWLockAcquire(ZSMetaCacheLock, LW_EXCLUSIVE);
+	entry = zsmeta_shared_cache_enter(&rel->rd_node);
+	SpinLockAcquire(&entry->mutex);
+	*change_count = entry->change_count;
+	SpinLockRelease(&entry->mutex);
+	LWLockRelease(ZSMetaCacheLock);
+
+	return NULL;
+}
+
+/*
+ * Publish the root directory we read from the metapage in the shared cache,
+ * unless the entry was invalidated since we noted 'change_count'.
+ */
+static void
+zsmeta_publish_shared_cache(Relation rel, ZSMetaCacheData *cache,
+							uint64 change_count)
+{
+	ZSSharedMetaCacheEntry *entry;
+	int			natts = cache->cache_nattributes;
+
+	if (natts > ZS_SHARED_METACACHE_MAX_ATTS)
+		return;
+
+	LWLockAcquire(ZSMetaCacheLock, LW_SHARED);
+	entry = hash_search(ZSSharedMetaCache, &rel->rd_node, HASH_FIND, NULL);
+	if (entry)
+	{
+		SpinLockAcquire(&entry->mutex);
+		if (entry->change_count == change_count)
+		{
+			entry->nattributes = natts;
+			for (int i = 0; i < natts; i++)
+			{
+				entry->attrs[i].root = cache->cache_attrs[i].root;
+				entry->attrs[i].rightmost = InvalidBlockNumber;
+				entry->attrs[i].rightmost_lokey = InvalidZSTid;
+			}
+			entry->valid = true;
+		}
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(ZSMetaCacheLock);
+}
+
+/*
+ * Invalidate the shared cache entry of a relation.
+ *
+ * This must be called after changing the root directory on the metapage,
+ * while still holding the lock on it, and whenever a cached block number
+ * turns out to be wrong.
+ */
+void
+zsmeta_invalidate_shared_cache(Relation rel)
+{
+	ZSSharedMetaCacheEntry *entry;
+
+	if (!zsmeta_shared_cache_usable(rel))
+		return;
+
+	LWLockAcquire(ZSMetaCacheLock, LW_SHARED);
+	entry = hash_search(ZSSharedMetaCache, &rel->rd_node, HASH_FIND, NULL);
+	if (entry)
+	{
+		uint64		generation;
+
+		/* don't nest an emulated atomic's spinlock inside ours */
+		generation = pg_atomic_add_fetch_u64(ZSSharedMetaCacheGeneration, 1);
+		SpinLockAcquire(&entry->mutex);
+		entry->change_count = generation;
+		entry->valid = false;
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(ZSMetaCacheLock);
+}
+
+/*
+ * Forget any cached information about a relfilenode. Used when a new
+ * relfilenode is created, in case a relfilenode of a dropped relation is
+ * reused, and when a relation is truncated in place.
+ */
+void
+zsmeta_forget_shared_cache(const RelFileNode *rnode)
+{
+	ZSSharedMetaCacheEntry *entry;
+
+	LWLockAcquire(ZSMetaCacheLock, LW_SHARED);
+	entry = hash_search(ZSSharedMetaCache, rnode, HASH_FIND, NULL);
+	if (entry)
+	{
+		uint64		generation;
+
+		generation = pg_atomic_add_fetch_u64(ZSSharedMetaCacheGeneration, 1);
+		SpinLockAcquire(&entry->mutex);
+		entry->change_count = generation;
+		entry->valid = false;
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(ZSMetaCacheLock);
+}
+
+/*
+ * Publish a new rightmost leaf of an attribute tree, found by a descent.
+ */
+void
+zsmeta_update_shared_rightmost(Relation rel, AttrNumber attno,
+							   BlockNumber rightmost, zstid rightmost_lokey)
+{
+	ZSSharedMetaCacheEntry *entry;
+
+	if (!zsmeta_shared_cache_usable(rel))
+		return;
+
+	LWLockAcquire(ZSMetaCacheLock, LW_SHARED);
+	entry = hash_search(ZSSharedMetaCache, &rel->rd_node, HASH_FIND, NULL);
+	if (entry)
+	{
+		SpinLockAcquire(&entry->mutex);
+		if (entry->valid && attno < entry->nattributes &&
+			(entry->attrs[attno].rightmost == InvalidBlockNumber ||
+			 entry->attrs[attno].rightmost_lokey < rightmost_lokey))
+		{
+			entry->attrs[attno].rightmost = rightmost;
+			entry->attrs[attno].rightmost_lokey = rightmost_lokey;
+		}
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(ZSMetaCacheLock);
+}
+
 static ZSMetaCacheData *
 zsmeta_populate_cache_from_metapage(Relation rel, Page page)
 {
@@ -61,12 +402,18 @@ zsmeta_populate_cache_from_metapage(Relation rel, Page page)
 	return cache;
 }
 
-ZSMetaCacheData *
-zsmeta_populate_cache(Relation rel)
+/*
+ * Rebuild the backend-private cache. If 'try_shared' is false, the shared
+ * cache is bypassed, and the cache is always built from the metapage itself.
+ */
+static ZSMetaCacheData *
+zsmeta_populate_cache_internal(Relation rel, bool try_shared)
 {
 	ZSMetaCacheData *cache;
 	Buffer		metabuf;
 	BlockNumber nblocks;
+	bool		use_shared;
+	uint64		change_count = 0;
 
 	RelationOpenSmgr(rel);
 
@@ -76,6 +423,23 @@ zsmeta_populate_cache(Relation rel)
 		rel->rd_amcache = NULL;
 	}
 
+	/*
+	 * Try the shared cache first. If we find the relation there, it has a
+	 * metapage, so we don't need to check the physical size either;
+	 * smgr_targblock only needs to say that the relation is not empty.
+	 */
+	use_shared = try_shared && zsmeta_shared_cache_usable(rel);
+	if (use_shared)
+	{
+		cache = zsmeta_populate_cache_from_shared(rel, &change_count);
+		if (cache)
+		{
+			RelationSetTargetBlock(rel, ZS_META_BLK + 1);
+			rel->rd_amcache = cache;
+			return cache;
+		}
+	}
+
 	nblocks = RelationGetNumberOfBlocks(rel);
 	RelationSetTargetBlock(rel, nblocks);
 	if (nblocks == 0)
@@ -92,11 +456,20 @@ zsmeta_populate_cache(Relation rel)
 		LockBuffer(metabuf, BUFFER_LOCK_SHARE);
 		cache = zsmeta_populate_cache_from_metapage(rel, BufferGetPage(metabuf));
 		UnlockReleaseBuffer(metabuf);
+
+		if (use_shared)
+			zsmeta_publish_shared_cache(rel, cache, change_count);
 	}
 
 	return cache;
 }
 
+ZSMetaCacheData *
+zsmeta_populate_cache(Relation rel)
+{
+	return zsmeta_populate_cache_internal(rel, true);
+}
+
 static void
 zsmeta_expand_metapage_for_new_attributes(Relation rel)
 {
@@ -141,6 +514,8 @@ zsmeta_expand_metapage_for_new_attributes(Relation rel)
 			zsmeta_wal_log_metapage(metabuf, natts);
 
 		END_CRIT_SECTION();
+
+		zsmeta_invalidate_shared_cache(rel);
 	}
 	UnlockReleaseBuffer(metabuf);
 
@@ -227,6 +602,8 @@ zsmeta_initmetapage(Relation rel)
 
 	END_CRIT_SECTION();
 
+	zsmeta_invalidate_shared_cache(rel);
+
 	UnlockReleaseBuffer(buf);
 }
 
@@ -388,8 +765,8 @@ zsmeta_get_root_for_attribute(Relation rel, AttrNumber attno, bool readonly)
 	{
 		if (readonly)
 		{
-			/* re-check */
-			metacache = zsmeta_populate_cache(rel);
+			/* re-check against the metapage itself */
+			metacache = zsmeta_populate_cache_internal(rel, false);
 			if (attno >= metacache->cache_nattributes)
 				return InvalidBlockNumber;
 		}
@@ -408,14 +785,17 @@ zsmeta_get_root_for_attribute(Relation rel, AttrNumber attno, bool readonly)
 	 * root block number is out-of-date, that's OK because the caller will
 	 * detect that case, but if the tree is missing altogether, the caller
 	 * will have nothing to detect and will incorrectly return an empty result.
+	 * The shared cache could be just as out of date as ours, so read the
+	 * metapage itself.
 	 *
 	 * XXX: It's a inefficient to repopulate the cache here, if we just
 	 * did so in the zsmeta_get_cache() call above already.
 	 */
 	if (readonly && rootblk == InvalidBlockNumber)
 	{
-		zsmeta_invalidate_cache(rel);
-		metacache = zsmeta_get_cache(rel);
+		metacache = zsmeta_populate_cache_internal(rel, false);
+		if (attno >= metacache->cache_nattributes)
+			return InvalidBlockNumber;
 		rootblk = metacache->cache_attrs[attno].root;
 	}
 
@@ -490,6 +870,8 @@ zsmeta_get_root_for_attribute(Relation rel, AttrNumber attno, bool readonly)
 					zsmeta_wal_log_new_att_root(metabuf, rootbuf, attno);
 
 				END_CRIT_SECTION();
+
+				zsmeta_invalidate_shared_cache(rel);
 			}
 
 			UnlockReleaseBuffer(rootbuf);
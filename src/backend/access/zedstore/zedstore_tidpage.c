@@ -26,6 +26,7 @@
  */
 #include "postgres.h"
 
+#include "access/xact.h"
 #include "access/xlogutils.h"
 #include "access/zedstore_internal.h"
 #include "access/zedstore_undorec.h"
@@ -61,6 +62,17 @@ static void zsbt_wal_log_tidleaf_items(Relation rel, Buffer buf,
 									   OffsetNumber off, bool replace, List *items,
 									   zs_pending_undo_op *undo_op);
 
+/*
+ * The last speculative insertion made by this backend. The executor always
+ * completes a speculative insertion before starting the next one, so
+ * remembering where its UNDO record is lets zsbt_tid_clear_speculative_token()
+ * clear the token without looking up the TID in the TID tree again.
+ */
+static RelFileNode last_spec_insert_relfilenode;
+static zstid last_spec_insert_tid = InvalidZSTid;
+static uint32 last_spec_insert_token;
+static ZSUndoRecPtr last_spec_insert_undoptr;
+
 /* ----------------------------------------------------------------
  *						 Public interface
  * ----------------------------------------------------------------
@@ -489,6 +501,7 @@ zsbt_tid_multi_insert(Relation rel, int ntuples,
 	zstid		tid;
 	ZSTidArrayItem *lastitem;
 	bool		modified_orig;
+	bool		is_speculative;
 
 	/*
 	 * Insert to the rightmost leaf.
@@ -539,6 +552,16 @@ zsbt_tid_multi_insert(Relation rel, int ntuples,
 	newitems = zsbt_tid_item_add_tids(lastitem, tid, ntuples, undo_op ? undo_op->reservation.undorecptr : InvalidUndoPtr,
 									  &modified_orig);
 
+	/* Remember speculative insertion, see zsbt_tid_clear_speculative_token() */
+	last_spec_insert_tid = InvalidZSTid;
+	is_speculative = (speculative_token != INVALID_SPECULATIVE_TOKEN && undo_op != NULL);
+	if (is_speculative)
+	{
+		last_spec_insert_relfilenode = rel->rd_node;
+		last_spec_insert_token = speculative_token;
+		last_spec_insert_undoptr = undo_op->reservation.undorecptr;
+	}
+
 	/*
 	 * Replace the original last item with the new items, or add new items.
 	 * This splits the page if necessary.
@@ -552,6 +575,9 @@ zsbt_tid_multi_insert(Relation rel, int ntuples,
 
 	list_free_deep(newitems);
 
+	if (is_speculative)
+		last_spec_insert_tid = tid;
+
 	/* Return the TIDs to the caller */
 	return tid;
 }
@@ -904,6 +930,7 @@ zsbt_tid_lock(Relation rel, zstid tid, TransactionId xid, CommandId cid,
 	TM_Result	result;
 	bool		keep_old_undo_ptr = true;
 	zs_pending_undo_op *undo_op;
+	ZSUndoRecPtr lock_undoptr;
 	List	   *newitems;
 	ZSTidArrayItem *origitem;
 
@@ -941,14 +968,46 @@ zsbt_tid_lock(Relation rel, zstid tid, TransactionId xid, CommandId cid,
 		}
 	}
 
-	/* Create UNDO record. */
-	undo_op = zsundo_create_for_tuple_lock(rel, xid, cid, tid, mode,
-										   keep_old_undo_ptr ? item_undoptr : InvalidUndoPtr);
+	/*
+	 * If we already hold a lock at least as strong as the requested one,
+	 * there's nothing to do. Like in heapam, a lock held by any
+	 * subtransaction of the current top transaction is good enough.
+	 */
+	if (result == TM_Ok && keep_old_undo_ptr && IsZSUndoRecPtrValid(&item_undoptr))
+	{
+		ZSUndoRec  *undorec = zsundo_fetch_record(rel, item_undoptr);
+
+		if (undorec && undorec->type == ZSUNDO_TYPE_TUPLE_LOCK &&
+			TransactionIdIsCurrentTransactionId(undorec->xid) &&
+			((ZSUndoRec_TupleLock *) undorec)->lockmode >= mode)
+		{
+			pfree(undorec);
+			UnlockReleaseBuffer(buf);
+			return TM_Ok;
+		}
+		if (undorec)
+			pfree(undorec);
+	}
+
+	/*
+	 * Create UNDO record, or reuse our previous lock record if the tuple
+	 * doesn't need to point to any older UNDO record.
+	 */
+	lock_undoptr = InvalidUndoPtr;
+	undo_op = NULL;
+	if (!keep_old_undo_ptr)
+		lock_undoptr = zsundo_find_reusable_tuple_lock(rel, xid, mode);
+	if (!IsZSUndoRecPtrValid(&lock_undoptr))
+	{
+		undo_op = zsundo_create_for_tuple_lock(rel, xid, cid, tid, mode,
+											   keep_old_undo_ptr ? item_undoptr : InvalidUndoPtr);
+		lock_undoptr = undo_op->reservation.undorecptr;
+	}
 
 	/* Replace the item with an identical one, but with updated undo pointer. */
 	page = BufferGetPage(buf);
 	origitem = (ZSTidArrayItem *) PageGetItem(page, PageGetItemId(page, off));
-	newitems = zsbt_tid_item_change_undoptr(origitem, tid, undo_op->reservation.undorecptr,
+	newitems = zsbt_tid_item_change_undoptr(origitem, tid, lock_undoptr,
 											recent_oldest_undo);
 	zsbt_tid_replace_item(rel, buf, off, newitems, undo_op);
 	list_free_deep(newitems);
@@ -987,7 +1046,7 @@ zsbt_collect_dead_tids(Relation rel, zstid starttid, zstid *endtid, uint64 *num_
 		if (nextblock != InvalidBlockNumber)
 		{
 			buf = ReleaseAndReadBuffer(buf, rel, nextblock);
-			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+			LockBuffer(buf, BUFFER_LOCK_SHARE);
 
 			if (!zsbt_page_is_expected(rel, ZS_META_ATTRIBUTE_NUM, nexttid, 0, buf))
 			{
@@ -1268,6 +1327,20 @@ zsbt_tid_clear_speculative_token(Relation rel, zstid tid, uint32 spectoken, bool
 	bool		item_isdead;
 	bool		found;
 
+	/*
+	 * Fast path: if this is the speculative insertion we just made, we
+	 * already know its UNDO record, and the token lives only there. No need
+	 * to descend the TID tree to find it.
+	 */
+	if (tid == last_spec_insert_tid &&
+		spectoken == last_spec_insert_token &&
+		RelFileNodeEquals(rel->rd_node, last_spec_insert_relfilenode))
+	{
+		last_spec_insert_tid = InvalidZSTid;
+		zsundo_clear_speculative_token(rel, last_spec_insert_undoptr);
+		return;
+	}
+
 	found = zsbt_tid_fetch(rel, tid, &buf, &item_undoptr, &item_isdead);
 	if (!found || item_isdead)
 		elog(ERROR, "couldn't find item for meta column for inserted tuple with TID (%u, %u) in rel %s",
@@ -18,8 +18,38 @@
 #include "miscadmin.h"
 #include "utils/datum.h"
 #include "utils/hashutils.h"
+#include "utils/memutils.h"
 
+/*
+ * TIDs are reserved in batches that start at TID_RESERVATION_SIZE, and
+ * grow on each new reservation by the same XID and CID, up to
+ * TID_RESERVATION_MAX_SIZE.
+ *
+ * All new TIDs are allocated at the end of the TID space, so every inserting
+ * backend has to lock the rightmost leaf of the TID tree to get them. Growing
+ * the batches means that a backend doing a large insertion comes back for
+ * more only a logarithmic number of times, and that each backend gets its
+ * own large, contiguous range of TIDs. The attribute data for those ranges is
+ * flushed in large chunks, so concurrent bulk inserters mostly end up
+ * writing to different attribute tree leaves, too.
+ *
+ * Whatever is left of the last reservation when the insertion ends has to
+ * be removed from the TID tree again, so apart from the first one, a
+ * reservation is never larger than half the number of rows the command has
+ * inserted so far. That keeps the unused TIDs to at most a third of those
+ * reserved, however the insertion size relates to the batch sizes.
+ *
+ * When many backends insert at the same time, each trip to the rightmost
+ * leaf is more expensive, because it means queuing behind the others. We
+ * notice that when the TIDs we get are not contiguous with the ones we got
+ * before, i.e. someone else allocated TIDs in between. From then on, the
+ * command switches to batch mode right away, and its reservations may be
+ * as large as the number of rows it has inserted so far, which halves the
+ * remaining trips, at the cost of leaving at most half of the TIDs reserved
+ * unused.
+ */
 #define TID_RESERVATION_SIZE		100
+#define TID_RESERVATION_MAX_SIZE	12800
 
 /*
  * If we see more than TID_RESERVATION_THRESHOLD insertions with the
@@ -59,6 +89,9 @@ typedef struct
 	zstid		reserved_tids_start;
 	zstid		reserved_tids_next;
 	zstid		reserved_tids_end;
+	int			reserved_tids_batch;	/* size of next reservation */
+	zstid		last_alloc_end;	/* end of our last allocation from the tree */
+	bool		contended;		/* others allocated TIDs in between? */
 
 } tuplebuffer;
 
@@ -124,6 +157,9 @@ retry:
 		tupbuffer->reserved_tids_start = InvalidZSTid;
 		tupbuffer->reserved_tids_next = InvalidZSTid;
 		tupbuffer->reserved_tids_end = InvalidZSTid;
+		tupbuffer->reserved_tids_batch = TID_RESERVATION_SIZE;
+		tupbuffer->last_alloc_end = InvalidZSTid;
+		tupbuffer->contended = false;
 		tupbuffer->num_repeated_inserts = 0;
 
 		MemoryContextSwitchTo(oldcxt);
@@ -157,6 +193,9 @@ zsbt_tuplebuffer_allocate_tid(Relation rel, TransactionId xid, CommandId cid)
 		 */
 		tuplebuffer_kill_unused_reserved_tids(rel, tupbuffer);
 		tupbuffer->num_repeated_inserts = 0;
+		tupbuffer->reserved_tids_batch = TID_RESERVATION_SIZE;
+		tupbuffer->last_alloc_end = InvalidZSTid;
+		tupbuffer->contended = false;
 
 		tupbuffer->reserved_tids_xid = xid;
 		tupbuffer->reserved_tids_cid = cid;
@@ -169,20 +208,42 @@ zsbt_tuplebuffer_allocate_tid(Relation rel, TransactionId xid, CommandId cid)
 		Assert(tupbuffer->reserved_tids_next < tupbuffer->reserved_tids_end);
 		result = (tupbuffer->reserved_tids_next++);
 	}
-	else if (tupbuffer->num_repeated_inserts < TID_RESERVATION_THRESHOLD)
+	else if (tupbuffer->num_repeated_inserts < TID_RESERVATION_THRESHOLD &&
+			 !tupbuffer->contended)
 	{
 		/* We haven't seen many inserts yet, so just allocate a single TID for this. */
 		result = zsbt_tid_multi_insert(rel, 1, xid, cid,
 									   INVALID_SPECULATIVE_TOKEN, InvalidUndoPtr);
+		if (tupbuffer->last_alloc_end != InvalidZSTid &&
+			result != tupbuffer->last_alloc_end)
+			tupbuffer->contended = true;
+		tupbuffer->last_alloc_end = result + 1;
 	}
 	else
 	{
 		/* We're in batch mode. Reserve a new block of TIDs. */
-		result = zsbt_tid_multi_insert(rel, TID_RESERVATION_SIZE, xid, cid,
+		int			nreserve;
+		uint64		limit;
+
+		limit = tupbuffer->contended ? tupbuffer->num_repeated_inserts :
+			tupbuffer->num_repeated_inserts / 2;
+		nreserve = Min(tupbuffer->reserved_tids_batch,
+					   Max(TID_RESERVATION_SIZE, limit));
+
+		result = zsbt_tid_multi_insert(rel, nreserve, xid, cid,
 									   INVALID_SPECULATIVE_TOKEN, InvalidUndoPtr);
+		if (tupbuffer->last_alloc_end != InvalidZSTid &&
+			result != tupbuffer->last_alloc_end)
+			tupbuffer->contended = true;
+		tupbuffer->last_alloc_end = result + nreserve;
+
 		tupbuffer->reserved_tids_start = result;
 		tupbuffer->reserved_tids_next = result + 1;
-		tupbuffer->reserved_tids_end = result + TID_RESERVATION_SIZE;
+		tupbuffer->reserved_tids_end = result + nreserve;
+
+		/* Reserve more next time, if this insertion keeps going */
+		tupbuffer->reserved_tids_batch = Min(nreserve * 2,
+											 TID_RESERVATION_MAX_SIZE);
 	}
 
 	tupbuffer->num_repeated_inserts++;
@@ -371,6 +432,8 @@ zsbt_attbuffer_flush(Relation rel, AttrNumber attno, attbuffer *attbuffer, bool
 static void
 tuplebuffer_kill_unused_reserved_tids(Relation rel, tuplebuffer *tupbuffer)
 {
+	MemoryContext tmpcontext;
+	MemoryContext oldcontext;
 	IntegerSet *unused_tids;
 	zstid		tid;
 
@@ -380,15 +443,17 @@ tuplebuffer_kill_unused_reserved_tids(Relation rel, tuplebuffer *tupbuffer)
 	/*
 	 * XXX: We use the zsbt_tid_remove() function for this, but it's
 	 * a bit too heavy-weight. It's geared towards VACUUM and removing
-	 * millions of TIDs in one go. Also, we leak the IntegerSet object;
-	 * usually flushing is done at end of transaction, so that's not
-	 * a problem, but it could be if we need to flush a lot in the
-	 * same transaction.
+	 * millions of TIDs in one go.
 	 *
 	 * XXX: It would be nice to adjust the UNDO record, too. Otherwise,
 	 * if we abort, the poor sod that tries to discard the UNDO record
 	 * will try to mark these TIDs as unused in vein.
 	 */
+	tmpcontext = AllocSetContextCreate(CurrentMemoryContext,
+									   "ZedstoreUnusedTids",
+									   ALLOCSET_SMALL_SIZES);
+	oldcontext = MemoryContextSwitchTo(tmpcontext);
+
 	unused_tids = intset_create();
 
 	for (tid = tupbuffer->reserved_tids_next;
@@ -400,6 +465,9 @@ tuplebuffer_kill_unused_reserved_tids(Relation rel, tuplebuffer *tupbuffer)
 
 	zsbt_tid_remove(rel, unused_tids);
 
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextDelete(tmpcontext);
+
 	tupbuffer->reserved_tids_start = InvalidZSTid;
 	tupbuffer->reserved_tids_next = InvalidZSTid;
 	tupbuffer->reserved_tids_end = InvalidZSTid;
@@ -409,6 +477,9 @@ static void
 tuplebuffer_flush_internal(Relation rel, tuplebuffer *tupbuffer)
 {
 	tuplebuffer_kill_unused_reserved_tids(rel, tupbuffer);
+	tupbuffer->reserved_tids_batch = TID_RESERVATION_SIZE;
+	tupbuffer->last_alloc_end = InvalidZSTid;
+	tupbuffer->contended = false;
 
 	/* Flush the attribute data */
 	for (AttrNumber attno = 1; attno <= tupbuffer->natts; attno++)
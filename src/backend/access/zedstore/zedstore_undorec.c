@@ -198,6 +198,13 @@ zsundo_create_for_delete(Relation rel, TransactionId xid, CommandId cid, zstid t
  * with same visibility information, and consecutive TIDs, we will keep modifying
  * the range of TIDs in the same UNDO record, instead of creating new records.
  * That greatly reduces the space required for UNDO log of bulk inserts.
+ *
+ * This matters most for single-row inserts that don't go through the tuple
+ * buffer's TID reservations, e.g. a multi-row INSERT of only a few rows: as
+ * long as no other backend inserts in between, all the rows share one UNDO
+ * record, and the TID tree item covering them only needs one UNDO slot.
+ * Speculative insertions are never merged, because the token must be cleared
+ * for each row separately.
  */
 zs_pending_undo_op *
 zsundo_create_for_insert(Relation rel, TransactionId xid, CommandId cid, zstid tid,
@@ -206,6 +213,59 @@ zsundo_create_for_insert(Relation rel, TransactionId xid, CommandId cid, zstid t
 	ZSUndoRec_Insert *undorec;
 	zs_pending_undo_op *pending_op;
 
+	static RelFileNode cached_relfilenode;
+	static TransactionId cached_xid = InvalidTransactionId;
+	static CommandId cached_cid;
+	static ZSUndoRecPtr cached_prev_undo_ptr;
+	static ZSUndoRecPtr cached_undo_ptr;
+	static zstid cached_endtid;
+
+	if (speculative_token == INVALID_SPECULATIVE_TOKEN &&
+		RelFileNodeEquals(rel->rd_node, cached_relfilenode) &&
+		xid == cached_xid &&
+		cid == cached_cid &&
+		prev_undo_ptr.counter == cached_prev_undo_ptr.counter &&
+		tid == cached_endtid)
+	{
+		Buffer		buf;
+		ZSUndoRec_Insert *orig_undorec;
+
+		/*
+		 * The record might never have been written, if the insertion that
+		 * reserved it errored out, so tolerate it being missing, and check
+		 * that it's really the record we created.
+		 */
+		orig_undorec = (ZSUndoRec_Insert *) zsundo_fetch(rel, cached_undo_ptr,
+														 &buf, BUFFER_LOCK_EXCLUSIVE, true);
+		if (orig_undorec)
+		{
+			if (orig_undorec->rec.type == ZSUNDO_TYPE_INSERT &&
+				orig_undorec->rec.undorecptr.counter == cached_undo_ptr.counter &&
+				orig_undorec->rec.xid == xid &&
+				orig_undorec->rec.cid == cid &&
+				orig_undorec->endtid == tid &&
+				orig_undorec->speculative_token == INVALID_SPECULATIVE_TOKEN)
+			{
+				pending_op = palloc(offsetof(zs_pending_undo_op, payload) + sizeof(ZSUndoRec_Insert));
+				undorec = (ZSUndoRec_Insert *) pending_op->payload;
+
+				pending_op->reservation.undobuf = buf;
+				pending_op->reservation.undorecptr = cached_undo_ptr;
+				pending_op->reservation.length = sizeof(ZSUndoRec_Insert);
+				pending_op->reservation.ptr = (char *) orig_undorec;
+				pending_op->is_update = true;
+
+				memcpy(undorec, orig_undorec, sizeof(ZSUndoRec_Insert));
+				undorec->endtid = tid + nitems;
+
+				cached_endtid = undorec->endtid;
+
+				return pending_op;
+			}
+			UnlockReleaseBuffer(buf);
+		}
+	}
+
 	/*
 	 * Cache miss. Create a new UNDO record.
 	 */
@@ -224,6 +284,18 @@ zsundo_create_for_insert(Relation rel, TransactionId xid, CommandId cid, zstid t
 	undorec->endtid = tid + nitems;
 	undorec->speculative_token = speculative_token;
 
+	if (speculative_token == INVALID_SPECULATIVE_TOKEN)
+	{
+		cached_relfilenode = rel->rd_node;
+		cached_xid = xid;
+		cached_cid = cid;
+		cached_prev_undo_ptr = prev_undo_ptr;
+		cached_undo_ptr = pending_op->reservation.undorecptr;
+		cached_endtid = undorec->endtid;
+	}
+	else
+		cached_xid = InvalidTransactionId;
+
 	return pending_op;
 }
 
@@ -256,6 +328,60 @@ zsundo_create_for_update(Relation rel, TransactionId xid, CommandId cid,
 	return pending_op;
 }
 
+/*
+ * The last TUPLE_LOCK record created by this backend, that didn't point to
+ * any older UNDO record. See zsundo_find_reusable_tuple_lock().
+ */
+static RelFileNode cached_lock_relfilenode;
+static TransactionId cached_lock_xid = InvalidTransactionId;
+static LockTupleMode cached_lock_mode;
+static ZSUndoRecPtr cached_lock_undo_ptr;
+
+/*
+ * Find an existing TUPLE_LOCK record that can be used to lock another tuple.
+ *
+ * A TUPLE_LOCK record doesn't say which tuple it locks; that's determined by
+ * the TID items pointing to it. So if the tuple has no older UNDO record that
+ * we need to chain to, we can make its TID item point to the last lock record
+ * we created with the same XID and lock mode, instead of writing a new one.
+ * That way, locking many rows in share mode, as foreign key checks do, only
+ * needs one UNDO record per transaction and lock mode.
+ *
+ * Returns InvalidUndoPtr if there is no suitable record.
+ */
+ZSUndoRecPtr
+zsundo_find_reusable_tuple_lock(Relation rel, TransactionId xid,
+								LockTupleMode lockmode)
+{
+	ZSUndoRec_TupleLock *undorec;
+	ZSUndoRecPtr result = InvalidUndoPtr;
+	Buffer		buf;
+
+	if (!RelFileNodeEquals(rel->rd_node, cached_lock_relfilenode) ||
+		xid != cached_lock_xid ||
+		lockmode != cached_lock_mode)
+		return InvalidUndoPtr;
+
+	/*
+	 * Check that the record still exists. It might never have been written,
+	 * if the operation that reserved it errored out.
+	 */
+	undorec = (ZSUndoRec_TupleLock *) zsundo_fetch(rel, cached_lock_undo_ptr,
+												   &buf, BUFFER_LOCK_SHARE, true);
+	if (undorec)
+	{
+		if (undorec->rec.type == ZSUNDO_TYPE_TUPLE_LOCK &&
+			undorec->rec.undorecptr.counter == cached_lock_undo_ptr.counter &&
+			undorec->rec.xid == xid &&
+			!IsZSUndoRecPtrValid(&undorec->rec.prevundorec) &&
+			undorec->lockmode == lockmode)
+			result = cached_lock_undo_ptr;
+		UnlockReleaseBuffer(buf);
+	}
+
+	return result;
+}
+
 zs_pending_undo_op *
 zsundo_create_for_tuple_lock(Relation rel, TransactionId xid, CommandId cid,
 							 zstid tid, LockTupleMode lockmode,
@@ -278,8 +404,17 @@ zsundo_create_for_tuple_lock(Relation rel, TransactionId xid, CommandId cid,
 	undorec->rec.xid = xid;
 	undorec->rec.cid = cid;
 	undorec->rec.prevundorec = prev_undo_ptr;
+	undorec->tid = tid;
 	undorec->lockmode = lockmode;
 
+	if (!IsZSUndoRecPtrValid(&prev_undo_ptr))
+	{
+		cached_lock_relfilenode = rel->rd_node;
+		cached_lock_xid = xid;
+		cached_lock_mode = lockmode;
+		cached_lock_undo_ptr = pending_op->reservation.undorecptr;
+	}
+
 	return pending_op;
 }
 
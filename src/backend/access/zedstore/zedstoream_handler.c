@@ -23,6 +23,7 @@
 #include "access/tsmapi.h"
 #include "access/tupdesc_details.h"
 #include "access/xact.h"
+#include "access/xloginsert.h"
 #include "access/zedstore_internal.h"
 #include "access/zedstore_undorec.h"
 #include "catalog/catalog.h"
@@ -72,6 +73,17 @@ typedef struct ZedStoreDescData
 	zstid       max_tid_to_scan;
 	zstid       next_tid_to_scan;
 
+	/*
+	 * Block-sampling methods (e.g. SYSTEM) choose "sample units" of this many
+	 * consecutive logical blocks, sized to roughly match one physical leaf
+	 * page of each tree. 'sample_next_blk' and 'sample_unit_end' are the
+	 * remaining logical blocks of the current unit.
+	 */
+	BlockNumber sample_unit_nblocks;
+	BlockNumber sample_nunits;
+	BlockNumber sample_next_blk;
+	BlockNumber sample_unit_end;
+
 } ZedStoreDescData;
 
 typedef struct ZedStoreDescData *ZedStoreDesc;
@@ -167,6 +179,15 @@ zedstoream_insert_internal(Relation relation, TupleTableSlot *slot, CommandId ci
 	MemoryContext oldcontext;
 	MemoryContext insert_mcontext;
 
+	/*
+	 * With TABLE_INSERT_FROZEN (COPY FREEZE), the relation was created or
+	 * truncated in this transaction, so if we abort, no one will see the rows
+	 * anyway. Insert them as frozen, without UNDO records. They will use the
+	 * "old" UNDO slot, so scans don't need to check their visibility either.
+	 */
+	if (options & TABLE_INSERT_FROZEN)
+		xid = FrozenTransactionId;
+
 	/*
 	 * insert code performs allocations for creating items and merging
 	 * items. These are small allocations but add-up based on number of
@@ -261,6 +282,10 @@ zedstoream_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		return;
 	}
 
+	/* Insert without UNDO records with COPY FREEZE. See zedstoream_insert_internal(). */
+	if (options & TABLE_INSERT_FROZEN)
+		xid = FrozenTransactionId;
+
 	firsttid = zsbt_tid_multi_insert(relation, ntuples, xid, cid,
 									 INVALID_SPECULATIVE_TOKEN, InvalidUndoPtr);
 
@@ -1117,7 +1142,15 @@ zedstoream_rescan(TableScanDesc sscan, struct ScanKeyData *key,
 							scan->cur_range_start, scan->cur_range_end, scan->cur_range_start - 1);
 
 		if ((scan->rs_scan.rs_flags & SO_TYPE_SAMPLESCAN) != 0)
+		{
+			/* the table may have changed; size the sample units again */
 			scan->next_tid_to_scan = ZSTidFromBlkOff(0, 1);
+			scan->max_tid_to_scan = InvalidZSTid;
+			scan->sample_unit_nblocks = 0;
+			scan->sample_nunits = 0;
+			scan->sample_next_blk = 0;
+			scan->sample_unit_end = 0;
+		}
 	}
 }
 
@@ -1191,8 +1224,7 @@ zedstoream_getnextslot(TableScanDesc sscan, ScanDirection direction,
 	 * columns are NULL.
 	 */
 	ExecClearTuple(slot);
-	for (int i = 0; i < slot_natts; i++)
-		slot_isnull[i] = true;
+	memset(slot_isnull, true, slot_natts * sizeof(bool));
 
 	/*
 	 * Find the next visible TID.
@@ -1231,37 +1263,42 @@ zedstoream_getnextslot(TableScanDesc sscan, ScanDirection direction,
 	 * because in a sequential scan, we predicate-locked the whole table.
 	 */
 
-	/* Fetch the datums of each attribute for this row */
+	/*
+	 * Fetch the datums of each attribute for this row.
+	 *
+	 * The decoders have already unpacked each attribute's current chunk into
+	 * plain arrays, with code specialized for the attribute's length and the
+	 * chunk's encoding, so all that's left per row is to pick the entries
+	 * for this TID.  zsbt_attr_fetch() has a fast path for the next entry,
+	 * which is what a sequential scan normally wants.  Only varlenas need a
+	 * closer look.
+	 */
 	for (int i = 1; i < scan_proj->num_proj_atts; i++)
 	{
 		ZSAttrTreeScan *btscan = &scan_proj->attr_scans[i - 1];
-		Form_pg_attribute attr = btscan->attdesc;
-		int			natt;
+		int			natt = scan_proj->proj_atts[i];
 
 		if (!zsbt_attr_fetch(btscan, &datum, &isnull, this_tid))
 			zsbt_fill_missing_attribute_value(slot->tts_tupleDescriptor, btscan->attno,
 											  &datum, &isnull);
 
-		/*
-		 * flatten any ZS-TOASTed values, because the rest of the system
-		 * doesn't know how to deal with them.
-		 */
-		natt = scan_proj->proj_atts[i];
-
-		if (!isnull && attr->attlen == -1 &&
-			VARATT_IS_EXTERNAL(datum) && VARTAG_EXTERNAL(datum) == VARTAG_ZEDSTORE)
+		if (!isnull && btscan->attdesc->attlen == -1)
 		{
-			MemoryContext oldcxt = CurrentMemoryContext;
+			/*
+			 * flatten any ZS-TOASTed values, because the rest of the system
+			 * doesn't know how to deal with them.
+			 */
+			if (VARATT_IS_EXTERNAL(datum) && VARTAG_EXTERNAL(datum) == VARTAG_ZEDSTORE)
+			{
+				MemoryContext oldcxt = CurrentMemoryContext;
 
-			if (btscan->decoder.tmpcxt)
-				MemoryContextSwitchTo(btscan->decoder.tmpcxt);
-			datum = zedstore_toast_flatten(scan->rs_scan.rs_rd, natt, this_tid, datum);
-			MemoryContextSwitchTo(oldcxt);
-		}
+				if (btscan->decoder.tmpcxt)
+					MemoryContextSwitchTo(btscan->decoder.tmpcxt);
+				datum = zedstore_toast_flatten(scan->rs_scan.rs_rd, natt, this_tid, datum);
+				MemoryContextSwitchTo(oldcxt);
+			}
 
-		/* Check that the values coming out of the b-tree are aligned properly */
-		if (!isnull && attr->attlen == -1)
-		{
+			/* Check that the values coming out of the b-tree are aligned properly */
 			Assert (VARATT_IS_1B(datum) || INTALIGN(datum) == datum);
 		}
 
@@ -2006,6 +2043,9 @@ zedstoream_relation_set_new_filenode(Relation rel,
 
 	srel = RelationCreateStorage(*newrnode, persistence);
 
+	/* In case the relfilenode was used by a dropped relation before */
+	zsmeta_forget_shared_cache(newrnode);
+
 	/*
 	 * If required, set up an init fork for an unlogged table so that it can
 	 * be correctly reinitialized on restart.  An immediate sync is required
@@ -2032,9 +2072,104 @@ zedstoream_relation_nontransactional_truncate(Relation rel)
 	/* XXX: I think we could just throw away all data in the buffer */
 	zsbt_tuplebuffer_flush(rel);
 	zsmeta_invalidate_cache(rel);
+	zsmeta_forget_shared_cache(&rel->rd_node);
 	RelationTruncate(rel, 0);
 }
 
+/*
+ * Copy the main fork of a zedstore relation to a new relfilenode.
+ *
+ * This is like RelationCopyStorage(), but we know what the pages look like.
+ * Any uncompressed data on attribute leaf pages is merged into the
+ * compressed stream on the fly, so that the copy takes less space and
+ * subsequent scans need to decode fewer uncompressed chunks. Each page is
+ * rewritten in place, so all block numbers, and hence all TIDs and UNDO
+ * pointers, stay valid.
+ */
+static void
+zedstoream_copy_storage(Relation rel, SMgrRelation dst)
+{
+	SMgrRelation src = rel->rd_smgr;
+	char		relpersistence = rel->rd_rel->relpersistence;
+	PGAlignedBlock buf;
+	Page		page;
+	bool		use_wal;
+	BlockNumber nblocks;
+	BlockNumber blkno;
+
+	page = (Page) buf.data;
+
+	/*
+	 * We need to log the copied data in WAL iff WAL archiving/streaming is
+	 * enabled AND it's a permanent relation.
+	 */
+	use_wal = XLogIsNeeded() && relpersistence == RELPERSISTENCE_PERMANENT;
+
+	nblocks = smgrnblocks(src, MAIN_FORKNUM);
+
+	for (blkno = 0; blkno < nblocks; blkno++)
+	{
+		bool		page_std = false;
+		uint16		zs_page_id;
+
+		/* If we got a cancel signal during the copy of the data, quit */
+		CHECK_FOR_INTERRUPTS();
+
+		smgrread(src, MAIN_FORKNUM, blkno, buf.data);
+
+		if (!PageIsVerified(page, blkno))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid page in block %u of relation %s",
+							blkno,
+							relpathbackend(src->smgr_rnode.node,
+										   src->smgr_rnode.backend,
+										   MAIN_FORKNUM))));
+
+		/*
+		 * Recompress attribute leaf pages. They use the standard page layout,
+		 * with the hole between pd_lower and pd_upper, so we can also omit
+		 * the hole from the WAL record. Leave everything else alone.
+		 */
+		zs_page_id = *((uint16 *) ((char *) page + BLCKSZ - sizeof(uint16)));
+		if (!PageIsNew(page) && zs_page_id == ZS_BTREE_PAGE_ID &&
+			PageGetSpecialSize(page) == MAXALIGN(sizeof(ZSBtreePageOpaque)))
+		{
+			ZSBtreePageOpaque *opaque = ZSBtreePageGetOpaque(page);
+
+			if (opaque->zs_level == 0 &&
+				opaque->zs_attno != ZS_META_ATTRIBUTE_NUM &&
+				opaque->zs_attno <= RelationGetNumberOfAttributes(rel))
+			{
+				Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel),
+													   opaque->zs_attno - 1);
+
+				(void) zsbt_attr_recompress_page(attr, page);
+				page_std = true;
+			}
+		}
+
+		if (use_wal)
+			log_newpage(&dst->smgr_rnode.node, MAIN_FORKNUM, blkno, page, page_std);
+
+		PageSetChecksumInplace(page, blkno);
+
+		/*
+		 * Now write the page.  We say skipFsync = true because there's no
+		 * need for smgr to schedule an fsync for this write; we'll do it
+		 * ourselves below.
+		 */
+		smgrextend(dst, MAIN_FORKNUM, blkno, buf.data, true);
+	}
+
+	/*
+	 * Since we copied outside shared buffers, a concurrent checkpoint can't
+	 * have flushed the new pages. See RelationCopyStorage().
+	 */
+	if (relpersistence == RELPERSISTENCE_PERMANENT)
+		smgrimmedsync(dst, MAIN_FORKNUM);
+}
+
 static void
 zedstoream_relation_copy_data(Relation rel, const RelFileNode *newrnode)
 {
@@ -2064,10 +2199,10 @@ zedstoream_relation_copy_data(Relation rel, const RelFileNode *newrnode)
 	 * this would need to copy other forks, too.
 	 */
 	RelationCreateStorage(*newrnode, rel->rd_rel->relpersistence);
+	zsmeta_forget_shared_cache(newrnode);
 
-	/* copy main fork */
-	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM,
-						rel->rd_rel->relpersistence);
+	/* copy main fork, recompressing attribute pages along the way */
+	zedstoream_copy_storage(rel, dstrel);
 
 	/* drop old relation, and close new one */
 	RelationDropStorage(rel);
@@ -2779,6 +2914,51 @@ zedstoream_scan_bitmap_next_tuple(TableScanDesc sscan,
 	return zs_blkscan_next_tuple(sscan, slot);
 }
 
+/*
+ * Number of logical blocks in each sample unit of a block-sampling scan.
+ *
+ * We look at the TID range covered by the leaf page holding the first TID,
+ * in the tree of the first projected attribute, or in the TID tree if no
+ * attributes are needed. The physical size of the relation would be a poor
+ * guide, since it includes UNDO, toast and free pages, and the trees of
+ * attributes that we don't read. The leaf pages of one tree don't all
+ * cover the same number of TIDs, so this is only an estimate, but the
+ * sample stays uniform over the TID space regardless; only the I/O per
+ * unit varies.
+ */
+static BlockNumber
+zs_sample_unit_nblocks(ZedStoreDesc scan, BlockNumber nlogical)
+{
+	Relation	rel = scan->rs_scan.rs_rd;
+	AttrNumber	attno = ZS_META_ATTRIBUTE_NUM;
+	zstid		firsttid;
+	zstid		endtid;
+	Buffer		buf;
+	ZSBtreePageOpaque *opaque;
+	BlockNumber nblocks;
+
+	if (scan->proj_data.num_proj_atts > 1)
+		attno = scan->proj_data.proj_atts[1];
+
+	firsttid = Max(scan->next_tid_to_scan, MinZSTid);
+	if (firsttid > scan->max_tid_to_scan)
+		return 1;
+
+	buf = zsbt_descend(rel, attno, firsttid, 0, true);
+	if (!BufferIsValid(buf))
+		return Max(nlogical, 1);
+	opaque = ZSBtreePageGetOpaque(BufferGetPage(buf));
+	endtid = Min(opaque->zs_hikey, scan->max_tid_to_scan + 1);
+	firsttid = Max(opaque->zs_lokey, MinZSTid);
+	UnlockReleaseBuffer(buf);
+
+	if (endtid <= firsttid)
+		return 1;
+	nblocks = ZSTidGetBlockNumber(endtid - 1) - ZSTidGetBlockNumber(firsttid) + 1;
+
+	return Max(nblocks, 1);
+}
+
 static bool
 zedstoream_scan_sample_next_block(TableScanDesc sscan, SampleScanState *scanstate)
 {
@@ -2801,80 +2981,115 @@ zedstoream_scan_sample_next_block(TableScanDesc sscan, SampleScanState *scanstat
 		scan->max_tid_to_scan = zsbt_get_last_tid(scan->rs_scan.rs_rd);
 	}
 
-	if (tsm->NextSampleBlock)
+	/*
+	 * A logical block holds only 128 TIDs, while one physical page
+	 * of an attribute tree typically holds data for thousands of them, so if
+	 * a block-sampling method picked individual logical blocks, nearly every
+	 * sampled block would cost a page read per attribute, and a 1% sample
+	 * could end up reading most of the table. Instead, let the sampling
+	 * method choose among "sample units" of consecutive logical blocks, each
+	 * covering about as many TIDs as a leaf page of the trees we read.
+	 * Sampling a unit then costs roughly one leaf page per tree.
+	 */
+	if (tsm->NextSampleBlock && scan->sample_unit_nblocks == 0)
 	{
-		/* Adding one below to convert block number to number of blocks. */
-		blockno = tsm->NextSampleBlock(scanstate,
-									   ZSTidGetBlockNumber(scan->max_tid_to_scan) + 1);
+		BlockNumber nlogical = ZSTidGetBlockNumber(scan->max_tid_to_scan) + 1;
 
-		if (!BlockNumberIsValid(blockno))
-			return false;
+		scan->sample_unit_nblocks = zs_sample_unit_nblocks(scan, nlogical);
+		scan->sample_nunits = (nlogical + scan->sample_unit_nblocks - 1) / scan->sample_unit_nblocks;
+		scan->sample_next_blk = 0;
+		scan->sample_unit_end = 0;
 	}
-	else
+
+	for (;;)
 	{
-		/* scanning table sequentially */
-		if (scan->next_tid_to_scan > scan->max_tid_to_scan)
-			return false;
+		if (tsm->NextSampleBlock)
+		{
+			if (scan->sample_next_blk >= scan->sample_unit_end)
+			{
+				BlockNumber nlogical = ZSTidGetBlockNumber(scan->max_tid_to_scan) + 1;
+				BlockNumber unit;
 
-		blockno = ZSTidGetBlockNumber(scan->next_tid_to_scan);
-		/* move on to next block of tids for next iteration of scan */
-		scan->next_tid_to_scan = ZSTidFromBlkOff(blockno + 1, 1);
-	}
+				unit = tsm->NextSampleBlock(scanstate, scan->sample_nunits);
+				if (!BlockNumberIsValid(unit))
+					return false;
 
-	Assert(BlockNumberIsValid(blockno));
+				scan->sample_next_blk = unit * scan->sample_unit_nblocks;
+				scan->sample_unit_end = Min(scan->sample_next_blk + scan->sample_unit_nblocks,
+											nlogical);
+				continue;
+			}
+			blockno = scan->sample_next_blk++;
+		}
+		else
+		{
+			/* scanning table sequentially */
+			if (scan->next_tid_to_scan > scan->max_tid_to_scan)
+				return false;
 
-	/*
-	 * Fetch all TIDs on the page.
-	 */
-	if (!zs_blkscan_next_block(sscan, blockno, NULL, -1, false))
-		return false;
+			blockno = ZSTidGetBlockNumber(scan->next_tid_to_scan);
+			/* move on to next block of tids for next iteration of scan */
+			scan->next_tid_to_scan = ZSTidFromBlkOff(blockno + 1, 1);
+		}
 
-	/*
-	 * Filter the list of TIDs, keeping only the TIDs that the sampling methods
-	 * tells us to keep.
-	 */
-	if (scan->bmscan_ntuples > 0)
-	{
-		zstid		lasttid_for_block = scan->bmscan_tids[scan->bmscan_ntuples - 1];
-		OffsetNumber maxoffset = ZSTidGetOffsetNumber(lasttid_for_block);
-		OffsetNumber nextoffset;
-		int			outtuples;
-		int			idx;
-
-		/* ask the tablesample method which tuples to check on this page. */
-		nextoffset = tsm->NextSampleTuple(scanstate, blockno, maxoffset);
-
-		outtuples = 0;
-		idx = 0;
-		while (idx < scan->bmscan_ntuples && OffsetNumberIsValid(nextoffset))
+		Assert(BlockNumberIsValid(blockno));
+
+		/*
+		 * Fetch all TIDs on the page. If there are none, e.g. because they
+		 * were all deleted, move on to the next block. (Returning false would
+		 * end the whole scan.)
+		 */
+		if (!zs_blkscan_next_block(sscan, blockno, NULL, -1, false))
+			continue;
+
+		/*
+		 * Filter the list of TIDs, keeping only the TIDs that the sampling methods
+		 * tells us to keep.
+		 */
+		if (scan->bmscan_ntuples > 0)
 		{
-			zstid		thistid = scan->bmscan_tids[idx];
-			OffsetNumber thisoffset = ZSTidGetOffsetNumber(thistid);
+			zstid		lasttid_for_block = scan->bmscan_tids[scan->bmscan_ntuples - 1];
+			OffsetNumber maxoffset = ZSTidGetOffsetNumber(lasttid_for_block);
+			OffsetNumber nextoffset;
+			int			outtuples;
+			int			idx;
 
-			if (thisoffset > nextoffset)
-				nextoffset = tsm->NextSampleTuple(scanstate, blockno, maxoffset);
-			else
+			/* ask the tablesample method which tuples to check on this page. */
+			nextoffset = tsm->NextSampleTuple(scanstate, blockno, maxoffset);
+
+			outtuples = 0;
+			idx = 0;
+			while (idx < scan->bmscan_ntuples && OffsetNumberIsValid(nextoffset))
 			{
-				if (thisoffset == nextoffset)
-					scan->bmscan_tids[outtuples++] = thistid;
-				idx++;
+				zstid		thistid = scan->bmscan_tids[idx];
+				OffsetNumber thisoffset = ZSTidGetOffsetNumber(thistid);
+
+				if (thisoffset > nextoffset)
+					nextoffset = tsm->NextSampleTuple(scanstate, blockno, maxoffset);
+				else
+				{
+					if (thisoffset == nextoffset)
+						scan->bmscan_tids[outtuples++] = thistid;
+					idx++;
+				}
 			}
+			scan->bmscan_ntuples = outtuples;
+
+			/*
+			 * Must fast forward the sampler through all offsets on this page,
+			 * until it returns InvalidOffsetNumber. Otherwise, the next
+			 * call will continue to return offsets for this block.
+			 *
+			 * FIXME: It seems bogus that the sampler isn't reset, when you call
+			 * NextSampleBlock(). Perhaps we should fix this in the TSM API?
+			 */
+			while (OffsetNumberIsValid(nextoffset))
+				nextoffset = tsm->NextSampleTuple(scanstate, blockno, maxoffset);
 		}
-		scan->bmscan_ntuples = outtuples;
 
-		/*
-		 * Must fast forward the sampler through all offsets on this page,
-		 * until it returns InvalidOffsetNumber. Otherwise, the next
-		 * call will continue to return offsets for this block.
-		 *
-		 * FIXME: It seems bogus that the sampler isn't reset, when you call
-		 * NextSampleBlock(). Perhaps we should fix this in the TSM API?
-		 */
-		while (OffsetNumberIsValid(nextoffset))
-			nextoffset = tsm->NextSampleTuple(scanstate, blockno, maxoffset);
+		if (scan->bmscan_ntuples > 0)
+			return true;
 	}
-
-	return scan->bmscan_ntuples > 0;
 }
 
 static bool
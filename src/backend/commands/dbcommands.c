@@ -963,6 +963,9 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/* Also forget the cached sizes of its relations */
+	smgrdropdbsizes(db_id);
+
 	/*
 	 * Tell the stats collector to forget it immediately, too.
 	 */
@@ -1249,6 +1252,13 @@ movedb(const char *dbname, const char *tblspcname)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/*
+	 * Likewise for cached relation sizes.  If the database is later moved
+	 * back, the files are copied outside smgr, so stale sizes must not
+	 * survive.
+	 */
+	smgrdropdbsizes(db_id);
+
 	/*
 	 * Check for existence of files in the target directory, i.e., objects of
 	 * this database that are already in the target tablespace.  We can't
@@ -2191,6 +2201,9 @@ dbase_redo(XLogReaderState *record)
 		/* Drop pages for this database that are in the shared buffer cache */
 		DropDatabaseBuffers(xlrec->db_id);
 
+		/* And any cached relation sizes */
+		smgrdropdbsizes(xlrec->db_id);
+
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseSyncRequests(xlrec->db_id);
 
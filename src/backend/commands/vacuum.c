@@ -61,6 +61,7 @@ int			vacuum_freeze_min_age;
 int			vacuum_freeze_table_age;
 int			vacuum_multixact_freeze_min_age;
 int			vacuum_multixact_freeze_table_age;
+bool		vacuum_eager_freeze = true;
 
 
 /* A few variables that don't seem worth passing around as parameters */
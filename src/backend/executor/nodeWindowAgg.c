@@ -37,6 +37,7 @@
 #include "catalog/objectaccess.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
 #include "executor/executor.h"
 #include "executor/nodeWindowAgg.h"
 #include "miscadmin.h"
@@ -156,6 +157,27 @@ typedef struct WindowStatePerAggData
 
 	/* Data local to eval_windowaggregates() */
 	bool		restart;		/* need to restart this agg in this cycle? */
+
+	/*
+	 * Sliding-window evaluation using the combine function, for aggregates
+	 * without an inverse transition function in moving frames.  See
+	 * eval_windowaggregates() and sliding_push().  Per-row states live in
+	 * slidevalues/slidenulls, indexed by row position minus slidebase.
+	 */
+	bool		sliding_ok;		/* could we use sliding-window evaluation? */
+	bool		use_sliding;	/* are we using it in this partition? */
+	Oid			combinefn_oid;	/* InvalidOid unless sliding_ok */
+	FmgrInfo	combinefn;
+	MemoryContext slidecontext; /* holds the states below */
+	Datum	   *slidevalues;
+	bool	   *slidenulls;
+	int64		slidealloc;		/* allocated length of the arrays */
+	int64		slidebase;		/* row position of array element 0 */
+	int64		slidehead;		/* first row of the front stack */
+	int64		slidesplit;		/* first row of the back stack */
+	int64		slideupto;		/* first row not yet pushed */
+	Datum		backValue;		/* combination of all back stack states */
+	bool		backValueIsNull;
 } WindowStatePerAggData;
 
 static void initialize_windowaggregate(WindowAggState *winstate,
@@ -172,6 +194,17 @@ static void finalize_windowaggregate(WindowAggState *winstate,
 									 WindowStatePerAgg peraggstate,
 									 Datum *result, bool *isnull);
 
+static void sliding_reset(WindowStatePerAgg peraggstate, int64 pos);
+static void sliding_push(WindowAggState *winstate,
+						 WindowStatePerFunc perfuncstate,
+						 WindowStatePerAgg peraggstate);
+static void sliding_pop(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate);
+static void sliding_result(WindowAggState *winstate,
+						   WindowStatePerFunc perfuncstate,
+						   WindowStatePerAgg peraggstate);
+
 static void eval_windowaggregates(WindowAggState *winstate);
 static void eval_windowfunction(WindowAggState *winstate,
 								WindowStatePerFunc perfuncstate,
@@ -647,6 +680,315 @@ finalize_windowaggregate(WindowAggState *winstate,
 	MemoryContextSwitchTo(oldContext);
 }
 
+/*
+ * Sliding-window evaluation of aggregates
+ *
+ * An aggregate that has a combine function but no inverse transition
+ * function would otherwise have to be recomputed from scratch whenever the
+ * frame head moves, costing O(frame size) transition calls per row.  Instead
+ * we keep one partial transition state per frame row, arranged as two
+ * stacks.  The back stack holds the state of each single row from slidesplit
+ * up to slideupto, with their running combination in backValue; new rows
+ * are pushed onto it.  The front stack holds, for each row from slidehead up
+ * to slidesplit, the combination of that row and all the following front
+ * rows; rows leaving the frame are popped off it, and when it runs empty it
+ * is rebuilt from the back stack.  The state for the whole frame is then the
+ * combination of the top of the front stack and backValue.  Since neither
+ * end of the frame ever moves backwards, each row takes part in a bounded
+ * number of combine calls, so the amortized cost per row does not depend on
+ * the frame size.
+ */
+
+/*
+ * sliding_reset
+ * forget all sliding-window states, and start over at row 'pos'
+ */
+static void
+sliding_reset(WindowStatePerAgg peraggstate, int64 pos)
+{
+	MemoryContextResetAndDeleteChildren(peraggstate->slidecontext);
+	peraggstate->slidevalues = NULL;
+	peraggstate->slidenulls = NULL;
+	peraggstate->slidealloc = 0;
+	peraggstate->slidebase = pos;
+	peraggstate->slidehead = pos;
+	peraggstate->slidesplit = pos;
+	peraggstate->slideupto = pos;
+	peraggstate->backValue = (Datum) 0;
+	peraggstate->backValueIsNull = true;
+}
+
+/*
+ * sliding_free
+ * release a state previously stored in slidecontext
+ */
+static inline void
+sliding_free(WindowStatePerAgg peraggstate, Datum value, bool isnull)
+{
+	if (!peraggstate->transtypeByVal && !isnull)
+		pfree(DatumGetPointer(value));
+}
+
+/*
+ * sliding_combine
+ * combine two transition states, returning a fresh copy of the result
+ * allocated in 'resultcontext'
+ *
+ * As in nodeAgg.c, a strict combine function is never called with a NULL
+ * input; the other input is returned instead.  We don't pass the WindowAgg
+ * node as the call context, so AggCheckCallContext() will tell the function
+ * that it mustn't scribble on its inputs: both of them are states we keep
+ * around.
+ */
+static void
+sliding_combine(WindowAggState *winstate,
+				WindowStatePerFunc perfuncstate,
+				WindowStatePerAgg peraggstate,
+				Datum value1, bool isnull1,
+				Datum value2, bool isnull2,
+				MemoryContext resultcontext,
+				Datum *result, bool *isnull)
+{
+	LOCAL_FCINFO(fcinfo, 2);
+	MemoryContext tmpcontext = winstate->tmpcontext->ecxt_per_tuple_memory;
+	MemoryContext oldContext;
+	Datum		newVal;
+	bool		newIsNull;
+
+	if (peraggstate->combinefn.fn_strict && (isnull1 || isnull2))
+	{
+		newVal = isnull2 ? value1 : value2;
+		newIsNull = isnull1 && isnull2;
+	}
+	else
+	{
+		oldContext = MemoryContextSwitchTo(tmpcontext);
+		InitFunctionCallInfoData(*fcinfo, &(peraggstate->combinefn), 2,
+								 perfuncstate->winCollation,
+								 NULL, NULL);
+		fcinfo->args[0].value = value1;
+		fcinfo->args[0].isnull = isnull1;
+		fcinfo->args[1].value = value2;
+		fcinfo->args[1].isnull = isnull2;
+		newVal = FunctionCallInvoke(fcinfo);
+		newIsNull = fcinfo->isnull;
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	if (!peraggstate->transtypeByVal && !newIsNull)
+	{
+		oldContext = MemoryContextSwitchTo(resultcontext);
+		newVal = datumCopy(newVal,
+						   peraggstate->transtypeByVal,
+						   peraggstate->transtypeLen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	if (resultcontext != tmpcontext)
+		MemoryContextReset(tmpcontext);
+
+	*result = newVal;
+	*isnull = newIsNull;
+}
+
+/*
+ * sliding_push
+ * add the row in winstate->tmpcontext->ecxt_outertuple to the back stack
+ */
+static void
+sliding_push(WindowAggState *winstate,
+			 WindowStatePerFunc perfuncstate,
+			 WindowStatePerAgg peraggstate)
+{
+	MemoryContext oldContext;
+	int64		idx;
+	Datum		value;
+	bool		isnull;
+
+	/* Compute the row's own transition state in the private aggcontext */
+	initialize_windowaggregate(winstate, perfuncstate, peraggstate);
+	advance_windowaggregate(winstate, perfuncstate, peraggstate);
+
+	Assert(peraggstate->slideupto == winstate->aggregatedupto);
+
+	/* Make room for it, by discarding popped slots or enlarging the arrays */
+	if (peraggstate->slideupto - peraggstate->slidebase >= peraggstate->slidealloc)
+	{
+		int64		nused = peraggstate->slideupto - peraggstate->slidehead;
+		int64		nfree = peraggstate->slidehead - peraggstate->slidebase;
+
+		if (nfree > 0 && nused <= peraggstate->slidealloc / 2)
+		{
+			memmove(peraggstate->slidevalues,
+					peraggstate->slidevalues + nfree,
+					nused * sizeof(Datum));
+			memmove(peraggstate->slidenulls,
+					peraggstate->slidenulls + nfree,
+					nused * sizeof(bool));
+			peraggstate->slidebase = peraggstate->slidehead;
+		}
+		else if (peraggstate->slidealloc == 0)
+		{
+			peraggstate->slidealloc = 64;
+			peraggstate->slidevalues = (Datum *)
+				MemoryContextAlloc(peraggstate->slidecontext,
+								   peraggstate->slidealloc * sizeof(Datum));
+			peraggstate->slidenulls = (bool *)
+				MemoryContextAlloc(peraggstate->slidecontext,
+								   peraggstate->slidealloc * sizeof(bool));
+		}
+		else
+		{
+			peraggstate->slidealloc *= 2;
+			peraggstate->slidevalues = (Datum *)
+				repalloc_huge(peraggstate->slidevalues,
+							  peraggstate->slidealloc * sizeof(Datum));
+			peraggstate->slidenulls = (bool *)
+				repalloc_huge(peraggstate->slidenulls,
+							  peraggstate->slidealloc * sizeof(bool));
+		}
+	}
+
+	/* Store a flat copy of it, since the aggcontext is reset for each row */
+	value = peraggstate->transValue;
+	isnull = peraggstate->transValueIsNull;
+	if (!peraggstate->transtypeByVal && !isnull)
+	{
+		oldContext = MemoryContextSwitchTo(peraggstate->slidecontext);
+		value = datumCopy(value,
+						  peraggstate->transtypeByVal,
+						  peraggstate->transtypeLen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	idx = peraggstate->slideupto - peraggstate->slidebase;
+	peraggstate->slidevalues[idx] = value;
+	peraggstate->slidenulls[idx] = isnull;
+
+	/* And fold it into the back stack's combined state */
+	if (peraggstate->slidesplit == peraggstate->slideupto)
+	{
+		if (!peraggstate->transtypeByVal && !isnull)
+		{
+			oldContext = MemoryContextSwitchTo(peraggstate->slidecontext);
+			value = datumCopy(value,
+							  peraggstate->transtypeByVal,
+							  peraggstate->transtypeLen);
+			MemoryContextSwitchTo(oldContext);
+		}
+		peraggstate->backValue = value;
+		peraggstate->backValueIsNull = isnull;
+	}
+	else
+	{
+		Datum		newVal;
+		bool		newIsNull;
+
+		sliding_combine(winstate, perfuncstate, peraggstate,
+						peraggstate->backValue, peraggstate->backValueIsNull,
+						value, isnull,
+						peraggstate->slidecontext,
+						&newVal, &newIsNull);
+		sliding_free(peraggstate, peraggstate->backValue,
+					 peraggstate->backValueIsNull);
+		peraggstate->backValue = newVal;
+		peraggstate->backValueIsNull = newIsNull;
+	}
+
+	peraggstate->slideupto++;
+}
+
+/*
+ * sliding_pop
+ * remove the first row of the frame
+ */
+static void
+sliding_pop(WindowAggState *winstate,
+			WindowStatePerFunc perfuncstate,
+			WindowStatePerAgg peraggstate)
+{
+	int64		idx;
+
+	Assert(peraggstate->slidehead < peraggstate->slideupto);
+
+	/*
+	 * If the front stack is empty, turn the back stack into a new front
+	 * stack, by combining each row's state with those of all later rows.
+	 */
+	if (peraggstate->slidehead == peraggstate->slidesplit)
+	{
+		for (idx = peraggstate->slideupto - peraggstate->slidebase - 2;
+			 idx >= peraggstate->slidehead - peraggstate->slidebase;
+			 idx--)
+		{
+			Datum		newVal;
+			bool		newIsNull;
+
+			sliding_combine(winstate, perfuncstate, peraggstate,
+							peraggstate->slidevalues[idx],
+							peraggstate->slidenulls[idx],
+							peraggstate->slidevalues[idx + 1],
+							peraggstate->slidenulls[idx + 1],
+							peraggstate->slidecontext,
+							&newVal, &newIsNull);
+			sliding_free(peraggstate, peraggstate->slidevalues[idx],
+						 peraggstate->slidenulls[idx]);
+			peraggstate->slidevalues[idx] = newVal;
+			peraggstate->slidenulls[idx] = newIsNull;
+		}
+		peraggstate->slidesplit = peraggstate->slideupto;
+		sliding_free(peraggstate, peraggstate->backValue,
+					 peraggstate->backValueIsNull);
+		peraggstate->backValue = (Datum) 0;
+		peraggstate->backValueIsNull = true;
+	}
+
+	idx = peraggstate->slidehead - peraggstate->slidebase;
+	sliding_free(peraggstate, peraggstate->slidevalues[idx],
+				 peraggstate->slidenulls[idx]);
+	peraggstate->slidehead++;
+}
+
+/*
+ * sliding_result
+ * set transValue to the transition state of the whole frame
+ *
+ * The result is only valid until the next sliding_push() or sliding_pop(),
+ * which is long enough for finalize_windowaggregate().
+ */
+static void
+sliding_result(WindowAggState *winstate,
+			   WindowStatePerFunc perfuncstate,
+			   WindowStatePerAgg peraggstate)
+{
+	bool		have_front = (peraggstate->slidehead < peraggstate->slidesplit);
+	bool		have_back = (peraggstate->slidesplit < peraggstate->slideupto);
+	int64		idx = peraggstate->slidehead - peraggstate->slidebase;
+
+	if (have_front && have_back)
+		sliding_combine(winstate, perfuncstate, peraggstate,
+						peraggstate->slidevalues[idx],
+						peraggstate->slidenulls[idx],
+						peraggstate->backValue,
+						peraggstate->backValueIsNull,
+						winstate->ss.ps.ps_ExprContext->ecxt_per_tuple_memory,
+						&peraggstate->transValue,
+						&peraggstate->transValueIsNull);
+	else if (have_front)
+	{
+		peraggstate->transValue = peraggstate->slidevalues[idx];
+		peraggstate->transValueIsNull = peraggstate->slidenulls[idx];
+	}
+	else if (have_back)
+	{
+		peraggstate->transValue = peraggstate->backValue;
+		peraggstate->transValueIsNull = peraggstate->backValueIsNull;
+	}
+	else
+	{
+		peraggstate->transValue = peraggstate->initValue;
+		peraggstate->transValueIsNull = peraggstate->initValueIsNull;
+	}
+}
+
 /*
  * eval_windowaggregates
  * evaluate plain aggregates being used as window functions
@@ -665,6 +1007,7 @@ eval_windowaggregates(WindowAggState *winstate)
 	int			wfuncno,
 				numaggs,
 				numaggs_restart,
+				numaggs_inverse,
 				i;
 	int64		aggregatedupto_nonrestarted;
 	MemoryContext oldContext;
@@ -709,6 +1052,15 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * must perform the aggregation all over again for all tuples within the
 	 * new frame boundaries.
 	 *
+	 * An exception to that are aggregates without an inverse transition
+	 * function that do have a combine function (see initialize_peragg for
+	 * the exact conditions).  For these, we keep a partial transition state
+	 * per row of the frame, and combine them as described above
+	 * sliding_reset().  Rows falling off the top of the frame are then simply
+	 * forgotten, without needing to re-read them.  If those states grow
+	 * larger than work_mem, we revert to restarting the aggregation for the
+	 * rest of the partition.
+	 *
 	 * If there's any exclusion clause, then we may have to aggregate over a
 	 * non-contiguous set of rows, so we punt and recalculate for every row.
 	 * (For some frame end choices, it might be that the frame is always
@@ -769,41 +1121,75 @@ eval_windowaggregates(WindowAggState *winstate)
 	 *
 	 * We restart the aggregation:
 	 *	 - if we're processing the first row in the partition, or
-	 *	 - if the frame's head moved and we cannot use an inverse
-	 *	   transition function, or
+	 *	 - if the frame's head moved and we can use neither an inverse
+	 *	   transition function nor sliding-window evaluation, or
 	 *	 - we have an EXCLUSION clause, or
-	 *	 - if the new frame doesn't overlap the old one
+	 *	 - if the new frame doesn't overlap the old one, or
+	 *	 - if sliding-window evaluation has just exceeded work_mem
 	 *
-	 * Note that we don't strictly need to restart in the last case, but if
+	 * Note that we don't strictly need to restart in the fourth case, but if
 	 * we're going to remove all rows from the aggregation anyway, a restart
 	 * surely is faster.
 	 *----------
 	 */
 	numaggs_restart = 0;
+	numaggs_inverse = 0;
 	for (i = 0; i < numaggs; i++)
 	{
+		bool		sliding_full = false;
+
 		peraggstate = &winstate->peragg[i];
+		if (peraggstate->use_sliding &&
+			MemoryContextMemAllocated(peraggstate->slidecontext, false) >
+			(Size) work_mem * 1024)
+		{
+			sliding_reset(peraggstate, winstate->frameheadpos);
+			peraggstate->use_sliding = false;
+			sliding_full = true;
+		}
+
 		if (winstate->currentpos == 0 ||
 			(winstate->aggregatedbase != winstate->frameheadpos &&
-			 !OidIsValid(peraggstate->invtransfn_oid)) ||
+			 !OidIsValid(peraggstate->invtransfn_oid) &&
+			 !peraggstate->use_sliding) ||
 			(winstate->frameOptions & FRAMEOPTION_EXCLUSION) ||
-			winstate->aggregatedupto <= winstate->frameheadpos)
+			winstate->aggregatedupto <= winstate->frameheadpos ||
+			sliding_full)
 		{
 			peraggstate->restart = true;
 			numaggs_restart++;
 		}
 		else
+		{
 			peraggstate->restart = false;
+			if (!peraggstate->use_sliding)
+				numaggs_inverse++;
+		}
+	}
+
+	/*
+	 * Sliding-window aggregates that we're not restarting just drop the
+	 * states of rows that fell off the top of the frame.
+	 */
+	for (i = 0; i < numaggs; i++)
+	{
+		peraggstate = &winstate->peragg[i];
+		if (peraggstate->restart || !peraggstate->use_sliding)
+			continue;
+
+		wfuncno = peraggstate->wfuncno;
+		while (peraggstate->slidehead < winstate->frameheadpos)
+			sliding_pop(winstate, &winstate->perfunc[wfuncno], peraggstate);
 	}
 
 	/*
-	 * If we have any possibly-moving aggregates, attempt to advance
+	 * If we have any other possibly-moving aggregates, attempt to advance
 	 * aggregatedbase to match the frame's head by removing input rows that
 	 * fell off the top of the frame from the aggregations.  This can fail,
 	 * i.e. advance_windowaggregate_base() can return false, in which case
 	 * we'll restart that aggregate below.
 	 */
-	while (numaggs_restart < numaggs &&
+	while (numaggs_inverse > 0 &&
 		   winstate->aggregatedbase < winstate->frameheadpos)
 	{
 		/*
@@ -826,7 +1212,7 @@ eval_windowaggregates(WindowAggState *winstate)
 			bool		ok;
 
 			peraggstate = &winstate->peragg[i];
-			if (peraggstate->restart)
+			if (peraggstate->restart || peraggstate->use_sliding)
 				continue;
 
 			wfuncno = peraggstate->wfuncno;
@@ -838,6 +1224,7 @@ eval_windowaggregates(WindowAggState *winstate)
 				/* Inverse transition function has failed, must restart */
 				peraggstate->restart = true;
 				numaggs_restart++;
+				numaggs_inverse--;
 			}
 		}
 
@@ -890,6 +1277,8 @@ eval_windowaggregates(WindowAggState *winstate)
 			initialize_windowaggregate(winstate,
 									   &winstate->perfunc[wfuncno],
 									   peraggstate);
+			if (peraggstate->use_sliding)
+				sliding_reset(peraggstate, winstate->frameheadpos);
 		}
 		else if (!peraggstate->resultValueIsNull)
 		{
@@ -961,9 +1350,14 @@ eval_windowaggregates(WindowAggState *winstate)
 				continue;
 
 			wfuncno = peraggstate->wfuncno;
-			advance_windowaggregate(winstate,
-									&winstate->perfunc[wfuncno],
-									peraggstate);
+			if (peraggstate->use_sliding)
+				sliding_push(winstate,
+							 &winstate->perfunc[wfuncno],
+							 peraggstate);
+			else
+				advance_windowaggregate(winstate,
+										&winstate->perfunc[wfuncno],
+										peraggstate);
 		}
 
 next_tuple:
@@ -990,6 +1384,10 @@ next_tuple:
 		wfuncno = peraggstate->wfuncno;
 		result = &econtext->ecxt_aggvalues[wfuncno];
 		isnull = &econtext->ecxt_aggnulls[wfuncno];
+		if (peraggstate->use_sliding)
+			sliding_result(winstate,
+						   &winstate->perfunc[wfuncno],
+						   peraggstate);
 		finalize_windowaggregate(winstate,
 								 &winstate->perfunc[wfuncno],
 								 peraggstate,
@@ -1332,8 +1730,17 @@ release_partition(WindowAggState *winstate)
 	MemoryContextResetAndDeleteChildren(winstate->aggcontext);
 	for (i = 0; i < winstate->numaggs; i++)
 	{
-		if (winstate->peragg[i].aggcontext != winstate->aggcontext)
-			MemoryContextResetAndDeleteChildren(winstate->peragg[i].aggcontext);
+		WindowStatePerAgg peraggstate = &winstate->peragg[i];
+
+		if (peraggstate->aggcontext != winstate->aggcontext)
+			MemoryContextResetAndDeleteChildren(peraggstate->aggcontext);
+
+		/* Retry sliding-window evaluation, if it was given up on */
+		if (peraggstate->sliding_ok)
+		{
+			sliding_reset(peraggstate, 0);
+			peraggstate->use_sliding = true;
+		}
 	}
 
 	if (winstate->buffer)
@@ -2558,6 +2965,8 @@ ExecEndWindowAgg(WindowAggState *node)
 	{
 		if (node->peragg[i].aggcontext != node->aggcontext)
 			MemoryContextDelete(node->peragg[i].aggcontext);
+		if (node->peragg[i].slidecontext)
+			MemoryContextDelete(node->peragg[i].slidecontext);
 	}
 	MemoryContextDelete(node->partcontext);
 	MemoryContextDelete(node->aggcontext);
@@ -2627,12 +3036,14 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	bool		use_ma_code;
 	Oid			transfn_oid,
 				invtransfn_oid,
-				finalfn_oid;
+				finalfn_oid,
+				combinefn_oid;
 	bool		finalextra;
 	char		finalmodify;
 	Expr	   *transfnexpr,
 			   *invtransfnexpr,
-			   *finalfnexpr;
+			   *finalfnexpr,
+			   *combinefnexpr;
 	Datum		textInitVal;
 	int			i;
 	ListCell   *lc;
@@ -2695,6 +3106,25 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		initvalAttNo = Anum_pg_aggregate_agginitval;
 	}
 
+	/*
+	 * If we're not using the moving-aggregate implementation although the
+	 * frame head can move, see if we can evaluate the aggregate over a
+	 * sliding window using its combine function instead.  That keeps a copy
+	 * of a transition state per frame row, so it's not possible with INTERNAL
+	 * states, which we can't copy; nor if an exclusion clause can make the
+	 * frame non-contiguous.  It evaluates the arguments only once per row, so
+	 * the same concern about volatile functions applies as above.
+	 */
+	if (!use_ma_code &&
+		OidIsValid(aggform->aggcombinefn) &&
+		aggtranstype != INTERNALOID &&
+		!(winstate->frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING) &&
+		!(winstate->frameOptions & FRAMEOPTION_EXCLUSION) &&
+		!contain_volatile_functions((Node *) wfunc))
+		combinefn_oid = aggform->aggcombinefn;
+	else
+		combinefn_oid = InvalidOid;
+
 	/*
 	 * ExecInitWindowAgg already checked permission to call aggregate function
 	 * ... but we still need to check the component functions
@@ -2739,6 +3169,16 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 							   get_func_name(finalfn_oid));
 			InvokeFunctionExecuteHook(finalfn_oid);
 		}
+
+		if (OidIsValid(combinefn_oid))
+		{
+			aclresult = pg_proc_aclcheck(combinefn_oid, aggOwner,
+										 ACL_EXECUTE);
+			if (aclresult != ACLCHECK_OK)
+				aclcheck_error(aclresult, OBJECT_FUNCTION,
+							   get_func_name(combinefn_oid));
+			InvokeFunctionExecuteHook(combinefn_oid);
+		}
 	}
 
 	/*
@@ -2764,6 +3204,8 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 											   inputTypes,
 											   numArguments);
 
+	peraggstate->combinefn_oid = combinefn_oid;
+
 	/* build expression trees using actual argument & result types */
 	build_aggregate_transfn_expr(inputTypes,
 								 numArguments,
@@ -2799,6 +3241,16 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		fmgr_info_set_expr((Node *) finalfnexpr, &peraggstate->finalfn);
 	}
 
+	if (OidIsValid(combinefn_oid))
+	{
+		build_aggregate_combinefn_expr(aggtranstype,
+									   wfunc->inputcollid,
+									   combinefn_oid,
+									   &combinefnexpr);
+		fmgr_info(combinefn_oid, &peraggstate->combinefn);
+		fmgr_info_set_expr((Node *) combinefnexpr, &peraggstate->combinefn);
+	}
+
 	/* get info about relevant datatypes */
 	get_typlenbyval(wfunc->wintype,
 					&peraggstate->resulttypeLen,
@@ -2865,7 +3317,7 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	 * they have historically been for plain aggregates, but that seems grotty
 	 * and likely to lead to memory leaks.
 	 */
-	if (OidIsValid(invtransfn_oid))
+	if (OidIsValid(invtransfn_oid) || OidIsValid(combinefn_oid))
 		peraggstate->aggcontext =
 			AllocSetContextCreate(CurrentMemoryContext,
 								  "WindowAgg Per Aggregate",
@@ -2873,6 +3325,29 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	else
 		peraggstate->aggcontext = winstate->aggcontext;
 
+	/*
+	 * Sliding-window aggregates, which also got their own aggcontext above
+	 * since they needn't restart along with the others, reset that context
+	 * for each row they add.  Their per-row states are kept in a separate
+	 * context.
+	 */
+	if (OidIsValid(combinefn_oid))
+	{
+		peraggstate->sliding_ok = true;
+		peraggstate->use_sliding = true;
+		peraggstate->slidecontext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "WindowAgg Sliding States",
+								  ALLOCSET_DEFAULT_SIZES);
+		sliding_reset(peraggstate, 0);
+	}
+	else
+	{
+		peraggstate->sliding_ok = false;
+		peraggstate->use_sliding = false;
+		peraggstate->slidecontext = NULL;
+	}
+
 	ReleaseSysCache(aggTuple);
 
 	return peraggstate;
@@ -3262,8 +3262,10 @@ query_tree_mutator(Query *query,
 		MUTATE(query->cteList, query->cteList, List *);
 	else						/* else copy CTE list as-is */
 		query->cteList = copyObject(query->cteList);
-	query->rtable = range_table_mutator(query->rtable,
-										mutator, context, flags);
+	if (!(flags & QTW_IGNORE_RANGE_TABLE))
+		query->rtable = range_table_mutator(query->rtable,
+											mutator, context, flags);
+	/* else the rangetable is left shared with the original Query */
 	return query;
 }
 
@@ -55,6 +55,12 @@
  */
 #define MAX_TUPLES_PER_PAGE  MaxHeapTuplesPerPage
 
+/*
+ * In a shared iteration, pages are handed out to the participating processes
+ * in aligned ranges of this many block numbers.
+ */
+#define TBM_SHARED_ITERATE_RANGE	32
+
 /*
  * When we have to switch over to lossy storage, we use a data structure
  * with one bit per page, where all pages having the same number DIV
@@ -221,6 +227,10 @@ struct TBMSharedIterator
 	PTEntryArray *ptbase;		/* pagetable element array */
 	PTIterationArray *ptpages;	/* sorted exact page index list */
 	PTIterationArray *ptchunks; /* sorted lossy page index list */
+	int			spageptr;		/* next spages index in our range */
+	int			schunkptr;		/* next schunks index in our range */
+	int			schunkbit;		/* next bit to check in current schunk */
+	uint64		range_end;		/* end of our range of block numbers */
 	TBMIterateResult output;	/* MUST BE LAST (because variable-size) */
 };
 
@@ -1041,27 +1051,27 @@ tbm_iterate(TBMIterator *iterator)
 }
 
 /*
- *	tbm_shared_iterate - scan through next page of a TIDBitmap
+ *	tbm_shared_claim_range - claim the next range of pages for this process
  *
- *	As above, but this will iterate using an iterator which is shared
- *	across multiple processes.  We need to acquire the iterator LWLock,
- *	before accessing the shared members.
+ *	Pages are handed out to the processes in a shared iteration in ranges of
+ *	TBM_SHARED_ITERATE_RANGE consecutive block numbers, aligned to a multiple
+ *	of the range size, rather than one page at a time.  That way each process
+ *	gets runs of neighbouring pages, which helps the table AM to reuse the
+ *	work it did for the previous page; for example, zedstore decodes many
+ *	logical blocks' worth of data from each attribute page, and heap benefits
+ *	from sequential I/O.
+ *
+ *	Advances the shared position past the claimed range, and sets up our
+ *	private position to iterate through it.  Returns false if there are no
+ *	more pages.
  */
-TBMIterateResult *
-tbm_shared_iterate(TBMSharedIterator *iterator)
+static bool
+tbm_shared_claim_range(TBMSharedIterator *iterator, PagetableEntry *ptbase,
+					   int *idxpages, int *idxchunks)
 {
-	TBMIterateResult *output = &iterator->output;
 	TBMSharedIteratorState *istate = iterator->state;
-	PagetableEntry *ptbase = NULL;
-	int		   *idxpages = NULL;
-	int		   *idxchunks = NULL;
-
-	if (iterator->ptbase != NULL)
-		ptbase = iterator->ptbase->ptentry;
-	if (iterator->ptpages != NULL)
-		idxpages = iterator->ptpages->index;
-	if (iterator->ptchunks != NULL)
-		idxchunks = iterator->ptchunks->index;
+	uint64		startblk = InvalidBlockNumber;
+	uint64		endblk;
 
 	/* Acquire the LWLock before accessing the shared members */
 	LWLockAcquire(&istate->lock, LW_EXCLUSIVE);
@@ -1079,6 +1089,7 @@ tbm_shared_iterate(TBMSharedIterator *iterator)
 		if (schunkbit < PAGES_PER_CHUNK)
 		{
 			istate->schunkbit = schunkbit;
+			startblk = chunk->blockno + schunkbit;
 			break;
 		}
 		/* advance to next chunk */
@@ -1086,52 +1097,135 @@ tbm_shared_iterate(TBMSharedIterator *iterator)
 		istate->schunkbit = 0;
 	}
 
-	/*
-	 * If both chunk and per-page data remain, must output the numerically
-	 * earlier page.
-	 */
-	if (istate->schunkptr < istate->nchunks)
+	/* The range starts at the numerically earlier of the next pages */
+	if (istate->spageptr < istate->npages)
+		startblk = Min(startblk, ptbase[idxpages[istate->spageptr]].blockno);
+
+	if (startblk == InvalidBlockNumber)
 	{
-		PagetableEntry *chunk = &ptbase[idxchunks[istate->schunkptr]];
-		BlockNumber chunk_blockno;
+		/* Nothing more in the bitmap */
+		LWLockRelease(&istate->lock);
+		return false;
+	}
 
-		chunk_blockno = chunk->blockno + istate->schunkbit;
+	endblk = startblk - startblk % TBM_SHARED_ITERATE_RANGE + TBM_SHARED_ITERATE_RANGE;
 
-		if (istate->spageptr >= istate->npages ||
-			chunk_blockno < ptbase[idxpages[istate->spageptr]].blockno)
-		{
-			/* Return a lossy page indicator from the chunk */
-			output->blockno = chunk_blockno;
-			output->ntuples = -1;
-			output->recheck = true;
-			istate->schunkbit++;
+	/* Our private iteration continues from the current shared position */
+	iterator->spageptr = istate->spageptr;
+	iterator->schunkptr = istate->schunkptr;
+	iterator->schunkbit = istate->schunkbit;
+	iterator->range_end = endblk;
 
-			LWLockRelease(&istate->lock);
-			return output;
+	/* Advance the shared position past the range */
+	while (istate->spageptr < istate->npages &&
+		   ptbase[idxpages[istate->spageptr]].blockno < endblk)
+		istate->spageptr++;
+
+	while (istate->schunkptr < istate->nchunks)
+	{
+		PagetableEntry *chunk = &ptbase[idxchunks[istate->schunkptr]];
+
+		if ((uint64) chunk->blockno + PAGES_PER_CHUNK <= endblk)
+		{
+			istate->schunkptr++;
+			istate->schunkbit = 0;
+			continue;
 		}
+		if (chunk->blockno < endblk)
+			istate->schunkbit = Max(istate->schunkbit,
+									(int) (endblk - chunk->blockno));
+		break;
 	}
 
-	if (istate->spageptr < istate->npages)
+	LWLockRelease(&istate->lock);
+
+	return true;
+}
+
+/*
+ *	tbm_shared_iterate - scan through next page of a TIDBitmap
+ *
+ *	As above, but this will iterate using an iterator which is shared
+ *	across multiple processes.  Each process claims a range of pages at a
+ *	time, see tbm_shared_claim_range(), and iterates through it privately.
+ *	The bitmap itself is read-only at this point, so that doesn't need the
+ *	lock.
+ */
+TBMIterateResult *
+tbm_shared_iterate(TBMSharedIterator *iterator)
+{
+	TBMIterateResult *output = &iterator->output;
+	TBMSharedIteratorState *istate = iterator->state;
+	PagetableEntry *ptbase = NULL;
+	int		   *idxpages = NULL;
+	int		   *idxchunks = NULL;
+
+	if (iterator->ptbase != NULL)
+		ptbase = iterator->ptbase->ptentry;
+	if (iterator->ptpages != NULL)
+		idxpages = iterator->ptpages->index;
+	if (iterator->ptchunks != NULL)
+		idxchunks = iterator->ptchunks->index;
+
+	for (;;)
 	{
-		PagetableEntry *page = &ptbase[idxpages[istate->spageptr]];
-		int			ntuples;
+		uint64		chunk_blockno = InvalidBlockNumber;
+		uint64		page_blockno = InvalidBlockNumber;
 
-		/* scan bitmap to extract individual offset numbers */
-		ntuples = tbm_extract_page_tuple(page, output);
-		output->blockno = page->blockno;
-		output->ntuples = ntuples;
-		output->recheck = page->recheck;
-		istate->spageptr++;
+		/*
+		 * If lossy chunk pages remain, make sure we've advanced schunkptr/
+		 * schunkbit to the next set bit.
+		 */
+		while (iterator->schunkptr < istate->nchunks)
+		{
+			PagetableEntry *chunk = &ptbase[idxchunks[iterator->schunkptr]];
 
-		LWLockRelease(&istate->lock);
+			tbm_advance_schunkbit(chunk, &iterator->schunkbit);
+			if (iterator->schunkbit < PAGES_PER_CHUNK)
+			{
+				chunk_blockno = chunk->blockno + iterator->schunkbit;
+				break;
+			}
+			/* advance to next chunk */
+			iterator->schunkptr++;
+			iterator->schunkbit = 0;
+		}
 
-		return output;
-	}
+		if (iterator->spageptr < istate->npages)
+			page_blockno = ptbase[idxpages[iterator->spageptr]].blockno;
 
-	LWLockRelease(&istate->lock);
+		/*
+		 * If both chunk and per-page data remain in our range, must output
+		 * the numerically earlier page.
+		 */
+		if (chunk_blockno < iterator->range_end && chunk_blockno < page_blockno)
+		{
+			/* Return a lossy page indicator from the chunk */
+			output->blockno = (BlockNumber) chunk_blockno;
+			output->ntuples = -1;
+			output->recheck = true;
+			iterator->schunkbit++;
+			return output;
+		}
 
-	/* Nothing more in the bitmap */
-	return NULL;
+		if (page_blockno < iterator->range_end)
+		{
+			PagetableEntry *page = &ptbase[idxpages[iterator->spageptr]];
+			int			ntuples;
+
+			/* scan bitmap to extract individual offset numbers */
+			ntuples = tbm_extract_page_tuple(page, output);
+			output->blockno = page->blockno;
+			output->ntuples = ntuples;
+			output->recheck = page->recheck;
+			iterator->spageptr++;
+			return output;
+		}
+
+		/* Our range is exhausted, claim the next one */
+		if (!tbm_shared_claim_range(iterator, ptbase, idxpages, idxchunks))
+			return NULL;
+	}
 }
 
 /*
@@ -1500,21 +1500,33 @@ inheritance_planner(PlannerInfo *root)
 
 		/*
 		 * Generate modified query with this rel as target.  We first apply
-		 * adjust_appendrel_attrs, which copies the Query and changes
+		 * adjust_inherited_target_query, which copies the Query and changes
 		 * references to the parent RTE to refer to the current child RTE,
-		 * then fool around with subquery RTEs.
+		 * then fool around with subquery RTEs.  Note that plain relation
+		 * RTEs, including those of the target relations, are shared between
+		 * all the child queries rather than copied for each.
 		 */
-		subroot->parse = (Query *)
-			adjust_appendrel_attrs(subroot,
-								   (Node *) parent_parse,
-								   1, &appinfo);
+		subroot->parse = adjust_inherited_target_query(subroot,
+													   parent_parse,
+													   appinfo);
 
 		/*
 		 * If there are securityQuals attached to the parent, move them to the
 		 * child rel (they've already been transformed properly for that).
+		 * The parent RTE was copied above since it has securityQuals, but the
+		 * child RTE is shared, so we must make a private copy of it first.
 		 */
 		parent_rte = rt_fetch(appinfo->parent_relid, subroot->parse->rtable);
 		child_rte = rt_fetch(appinfo->child_relid, subroot->parse->rtable);
+		if (parent_rte->securityQuals != NIL)
+		{
+			RangeTblEntry *newrte = makeNode(RangeTblEntry);
+
+			memcpy(newrte, child_rte, sizeof(RangeTblEntry));
+			lfirst(list_nth_cell(subroot->parse->rtable,
+								 appinfo->child_relid - 1)) = newrte;
+			child_rte = newrte;
+		}
 		child_rte->securityQuals = parent_rte->securityQuals;
 		parent_rte->securityQuals = NIL;
 
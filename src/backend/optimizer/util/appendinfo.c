@@ -226,6 +226,68 @@ adjust_appendrel_attrs(PlannerInfo *root, Node *node, int nappinfos,
 	return result;
 }
 
+/*
+ * adjust_inherited_target_query
+ *	  Translate the Query for an inherited UPDATE/DELETE so that it targets
+ *	  the child relation described by 'appinfo'.
+ *
+ * This is equivalent to applying adjust_appendrel_attrs to the Query, except
+ * that plain relation RTEs are not copied.  Those contain no expressions that
+ * could need translating and are not modified by planning, so the child
+ * Query shares them with its parent; only the List and any RTEs carrying
+ * expressions (subqueries, joins, functions and so on) are copied.
+ * inheritance_planner calls this once per target relation, and the range
+ * table contains an entry for each of them, so copying every RTE would make
+ * planning time and memory quadratic in the number of target relations.
+ */
+Query *
+adjust_inherited_target_query(PlannerInfo *root, Query *parse,
+							  AppendRelInfo *appinfo)
+{
+	Query	   *newquery;
+	List	   *newrtable = NIL;
+	ListCell   *lc;
+	adjust_appendrel_attrs_context context;
+
+	context.root = root;
+	context.nappinfos = 1;
+	context.appinfos = &appinfo;
+
+	newquery = query_tree_mutator(parse,
+								  adjust_appendrel_attrs_mutator,
+								  (void *) &context,
+								  QTW_IGNORE_RC_SUBQUERIES |
+								  QTW_IGNORE_RANGE_TABLE);
+
+	foreach(lc, parse->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_RELATION &&
+			rte->tablesample == NULL &&
+			rte->securityQuals == NIL)
+			newrtable = lappend(newrtable, rte);
+		else
+			newrtable = list_concat(newrtable,
+									range_table_mutator(list_make1(rte),
+														adjust_appendrel_attrs_mutator,
+														(void *) &context,
+														QTW_IGNORE_RC_SUBQUERIES));
+	}
+	newquery->rtable = newrtable;
+
+	if (newquery->resultRelation == appinfo->parent_relid)
+	{
+		newquery->resultRelation = appinfo->child_relid;
+		/* Fix tlist resnos too, if it's inherited UPDATE */
+		if (newquery->commandType == CMD_UPDATE)
+			newquery->targetList = adjust_inherited_tlist(newquery->targetList,
+														  appinfo);
+	}
+
+	return newquery;
+}
+
 static Node *
 adjust_appendrel_attrs_mutator(Node *node,
 							   adjust_appendrel_attrs_context *context)
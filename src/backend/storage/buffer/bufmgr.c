@@ -695,6 +695,62 @@ ReadBufferWithoutRelcache(RelFileNode rnode, ForkNumber forkNum,
 							 mode, strategy, &hit);
 }
 
+/*
+ * ReadRecentBuffer -- try to pin a shared buffer that recently held a block
+ *
+ * Given a shared buffer that was seen to hold the given block, e.g. while
+ * scanning the buffer descriptors, pin it if it still holds that block and
+ * its contents are valid.  Returns false, without pinning anything, if the
+ * buffer has been reused or isn't valid.  Unlike ReadBuffer, this never
+ * performs I/O, and doesn't need a relcache entry.
+ */
+bool
+ReadRecentBuffer(RelFileNode rnode, ForkNumber forkNum, BlockNumber blockNum,
+				 Buffer recent_buffer)
+{
+	BufferDesc *bufHdr;
+	BufferTag	tag;
+	uint32		buf_state;
+	bool		have_private_ref;
+
+	Assert(BufferIsValid(recent_buffer) && !BufferIsLocal(recent_buffer));
+
+	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+	ReservePrivateRefCountEntry();
+	INIT_BUFFERTAG(tag, rnode, forkNum, blockNum);
+
+	bufHdr = GetBufferDescriptor(recent_buffer - 1);
+	have_private_ref = GetPrivateRefCount(recent_buffer) > 0;
+
+	/*
+	 * If we already have the buffer pinned, its tag can't change, so it's
+	 * safe to check without the header lock.  Otherwise, lock the header
+	 * first; we mustn't pin a buffer that holds some other block, as that
+	 * could confuse InvalidateBuffer() and the like.
+	 */
+	if (have_private_ref)
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+	else
+		buf_state = LockBufHdr(bufHdr);
+
+	if ((buf_state & BM_VALID) && BUFFERTAGS_EQUAL(tag, bufHdr->tag))
+	{
+		if (have_private_ref)
+			PinBuffer(bufHdr, NULL);	/* bump pin count */
+		else
+			PinBuffer_Locked(bufHdr);	/* pin for first time */
+
+		pgBufferUsage.shared_blks_hit++;
+
+		return true;
+	}
+
+	if (!have_private_ref)
+		UnlockBufHdr(bufHdr, buf_state);
+
+	return false;
+}
+
 
 /*
  * ReadBuffer_common -- common logic for all ReadBuffer variants
@@ -18,9 +18,12 @@
 #include "postgres.h"
 
 #include "lib/ilist.h"
+#include "port/atomics.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/lwlock.h"
 #include "storage/md.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
@@ -94,8 +97,95 @@ static HTAB *SMgrRelationHash = NULL;
 
 static dlist_head unowned_relns;
 
+/*
+ * Shared cache of relation fork sizes.
+ *
+ * Finding out the size of a relation fork requires an lseek() system call
+ * on its last segment, and smgrnblocks() is called very frequently: by the
+ * planner, by every sequential scan, and on every relation extension. To
+ * avoid most of those calls, we keep the sizes of recently used forks in a
+ * hash table in shared memory.
+ *
+ * Like the shared buffer mapping table, the hash table is divided into
+ * NUM_RELSIZE_CACHE_PARTITIONS partitions by hash code, each protected by an
+ * LWLock of its own, so that lookups of different relations rarely contend.
+ * Each partition holds a fixed number of entries.  When a partition is full,
+ * a clock sweep over its entries evicts one that hasn't been looked up since
+ * the clock hand last passed it.
+ *
+ * The cached size is kept exact: smgrextend() and smgrtruncate() update it
+ * after changing the file, and it is removed when the fork is created or
+ * unlinked, or when a whole database is dropped or moved. On a cache miss,
+ * the size is read from the file without holding the partition lock, and
+ * entered into the cache afterwards. An extension or truncation of the fork
+ * that completed in between would be lost, since there was no entry for it
+ * to update, so every change to a fork that is not in the cache, and every
+ * removal of an entry, advances a counter of the partition. If the counter
+ * moved while the size was being read, the result is returned without
+ * entering it, just as if there was no cache. Extensions of the same fork
+ * are serialized by the callers (typically with the relation extension
+ * lock), so an entry never moves backwards except by truncation, which
+ * requires AccessExclusiveLock.
+ *
+ * Temporary relations are private to one backend and are not cached.
+ */
+typedef struct SMgrSizeCacheKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} SMgrSizeCacheKey;
+
+typedef struct SMgrSizeCacheEntry
+{
+	SMgrSizeCacheKey key;		/* hash key; must be first */
+	pg_atomic_uint32 nblocks;	/* current size of the fork */
+	pg_atomic_uint32 usage;		/* looked up since the clock hand passed? */
+	int			slot;			/* index in its partition's slots */
+} SMgrSizeCacheEntry;
+
+typedef struct SMgrSizeCachePartition
+{
+	pg_atomic_uint32 changes;	/* changes to forks not in the cache */
+	int			clock_hand;		/* next slot to consider for eviction */
+	SMgrSizeCacheEntry *slots[FLEXIBLE_ARRAY_MEMBER];	/* NULL if unused */
+} SMgrSizeCachePartition;
+
+/* GUC variable */
+int			max_cached_relation_sizes = 10000;
+
+static HTAB *SMgrSizeCache = NULL;
+static char *SMgrSizeCachePartitions = NULL;
+
+/* number of entries in each partition, and size of a partition's struct */
+#define SMgrSizeCachePartitionSlots() \
+	((max_cached_relation_sizes + NUM_RELSIZE_CACHE_PARTITIONS - 1) / \
+	 NUM_RELSIZE_CACHE_PARTITIONS)
+#define SMgrSizeCachePartitionSize() \
+	MAXALIGN(offsetof(SMgrSizeCachePartition, slots) + \
+			 SMgrSizeCachePartitionSlots() * sizeof(SMgrSizeCacheEntry *))
+
+#define SMgrSizeCacheHashPartition(hashcode) \
+	((hashcode) % NUM_RELSIZE_CACHE_PARTITIONS)
+#define SMgrSizeCachePartitionLockByIndex(i) \
+	(&MainLWLockArray[RELSIZE_CACHE_LWLOCK_OFFSET + (i)].lock)
+#define SMgrSizeCachePartitionByIndex(i) \
+	((SMgrSizeCachePartition *) \
+	 (SMgrSizeCachePartitions + (i) * SMgrSizeCachePartitionSize()))
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
+static BlockNumber smgrsizecache_lookup(SMgrRelation reln, ForkNumber forknum);
+static void smgrsizecache_insert(SMgrSizeCachePartition *partition,
+								 SMgrSizeCacheKey *key, uint32 hashcode,
+								 BlockNumber nblocks);
+static void smgrsizecache_remove(SMgrSizeCachePartition *partition,
+								 SMgrSizeCacheEntry *entry);
+static void smgrsizecache_update(SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber nblocks, bool extend);
+static void smgrsizecache_forget(RelFileNodeBackend rnode, ForkNumber forknum);
+
+#define SMgrSizeCacheEnabled(rnode) \
+	(SMgrSizeCache != NULL && !RelFileNodeBackendIsTemp(rnode))
 
 
 /*
@@ -333,6 +423,9 @@ void
 smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 {
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
+
+	/* In case the relfilenode was used by an earlier relation */
+	smgrsizecache_forget(reln->smgr_rnode, forknum);
 }
 
 /*
@@ -386,6 +479,8 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	 * xact.
 	 */
 	smgrsw[which].smgr_unlink(rnode, InvalidForkNumber, isRedo);
+
+	smgrsizecache_forget(rnode, InvalidForkNumber);
 }
 
 /*
@@ -464,6 +559,8 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
 			smgrsw[which].smgr_unlink(rnodes[i], forknum, isRedo);
+
+		smgrsizecache_forget(rnodes[i], InvalidForkNumber);
 	}
 
 	pfree(rnodes);
@@ -485,6 +582,8 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 {
 	smgrsw[reln->smgr_which].smgr_extend(reln, forknum, blocknum,
 										 buffer, skipFsync);
+
+	smgrsizecache_update(reln, forknum, blocknum + 1, true);
 }
 
 /*
@@ -554,6 +653,9 @@ smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
+	if (SMgrSizeCacheEnabled(reln->smgr_rnode))
+		return smgrsizecache_lookup(reln, forknum);
+
 	return smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
 }
 
@@ -594,6 +696,7 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	for (i = 0; i < nforks; i++)
 	{
 		smgrsw[reln->smgr_which].smgr_truncate(reln, forknum[i], nblocks[i]);
+		smgrsizecache_update(reln, forknum[i], nblocks[i], false);
 
 		/*
 		 * We might as well update the local smgr_fsm_nblocks and
@@ -639,6 +742,328 @@ smgrimmedsync(SMgrRelation reln, ForkNumber forknum)
 	smgrsw[reln->smgr_which].smgr_immedsync(reln, forknum);
 }
 
+/*
+ * Shared memory size of the relation size cache
+ */
+Size
+SMgrSizeCacheShmemSize(void)
+{
+	Size		size;
+
+	if (max_cached_relation_sizes <= 0)
+		return 0;
+
+	size = hash_estimate_size(SMgrSizeCachePartitionSlots() *
+							  NUM_RELSIZE_CACHE_PARTITIONS,
+							  sizeof(SMgrSizeCacheEntry));
+	size = add_size(size, mul_size(SMgrSizeCachePartitionSize(),
+								   NUM_RELSIZE_CACHE_PARTITIONS));
+	return size;
+}
+
+/*
+ * Initialize the relation size cache in shared memory
+ */
+void
+SMgrSizeCacheShmemInit(void)
+{
+	HASHCTL		info;
+	long		nentries;
+	bool		found;
+	int			i;
+
+	if (max_cached_relation_sizes <= 0)
+		return;
+
+	nentries = SMgrSizeCachePartitionSlots() * NUM_RELSIZE_CACHE_PARTITIONS;
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SMgrSizeCacheKey);
+	info.entrysize = sizeof(SMgrSizeCacheEntry);
+	info.num_partitions = NUM_RELSIZE_CACHE_PARTITIONS;
+
+	SMgrSizeCache = ShmemInitHash("Relation Size Cache",
+								  nentries, nentries,
+								  &info,
+								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	SMgrSizeCachePartitions = (char *)
+		ShmemInitStruct("Relation Size Cache Partitions",
+						SMgrSizeCachePartitionSize() * NUM_RELSIZE_CACHE_PARTITIONS,
+						&found);
+	if (!found)
+	{
+		MemSet(SMgrSizeCachePartitions, 0,
+			   SMgrSizeCachePartitionSize() * NUM_RELSIZE_CACHE_PARTITIONS);
+		for (i = 0; i < NUM_RELSIZE_CACHE_PARTITIONS; i++)
+			pg_atomic_init_u32(&SMgrSizeCachePartitionByIndex(i)->changes, 0);
+	}
+}
+
+/*
+ * smgrsizecache_lookup() -- smgrnblocks() through the shared size cache.
+ */
+static BlockNumber
+smgrsizecache_lookup(SMgrRelation reln, ForkNumber forknum)
+{
+	SMgrSizeCacheKey key;
+	SMgrSizeCacheEntry *entry;
+	SMgrSizeCachePartition *partition;
+	LWLock	   *partitionLock;
+	uint32		hashcode;
+	uint32		changes;
+	BlockNumber nblocks;
+
+	MemSet(&key, 0, sizeof(key));
+	key.rnode = reln->smgr_rnode.node;
+	key.forknum = forknum;
+
+	hashcode = get_hash_value(SMgrSizeCache, &key);
+	partition = SMgrSizeCachePartitionByIndex(SMgrSizeCacheHashPartition(hashcode));
+	partitionLock = SMgrSizeCachePartitionLockByIndex(SMgrSizeCacheHashPartition(hashcode));
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (SMgrSizeCacheEntry *)
+		hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+									HASH_FIND, NULL);
+	if (entry)
+	{
+		nblocks = pg_atomic_read_u32(&entry->nblocks);
+		/* avoid dirtying the cache line if it's already set */
+		if (pg_atomic_read_u32(&entry->usage) == 0)
+			pg_atomic_write_u32(&entry->usage, 1);
+		LWLockRelease(partitionLock);
+		return nblocks;
+	}
+	changes = pg_atomic_read_u32(&partition->changes);
+	LWLockRelease(partitionLock);
+
+	/* Read the size from the file, without holding the lock */
+	nblocks = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+	/*
+	 * Remember it, unless the fork was changed meanwhile; see comments at
+	 * the top of the file.
+	 */
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	if (pg_atomic_read_u32(&partition->changes) == changes)
+	{
+		entry = (SMgrSizeCacheEntry *)
+			hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+										HASH_FIND, NULL);
+		if (entry)
+			nblocks = pg_atomic_read_u32(&entry->nblocks);
+		else
+			smgrsizecache_insert(partition, &key, hashcode, nblocks);
+	}
+	LWLockRelease(partitionLock);
+
+	return nblocks;
+}
+
+/*
+ * smgrsizecache_insert() -- Enter a new fork into the size cache.
+ *
+ * The caller must hold the partition lock in exclusive mode. If the
+ * partition is full, an entry is evicted to make room, by running the clock
+ * hand until it finds an entry that hasn't been used since the last time it
+ * passed.
+ */
+static void
+smgrsizecache_insert(SMgrSizeCachePartition *partition, SMgrSizeCacheKey *key,
+					 uint32 hashcode, BlockNumber nblocks)
+{
+	SMgrSizeCacheEntry *entry;
+	bool		found;
+	int			slot;
+
+	for (;;)
+	{
+		slot = partition->clock_hand;
+		if (++partition->clock_hand >= SMgrSizeCachePartitionSlots())
+			partition->clock_hand = 0;
+
+		entry = partition->slots[slot];
+		if (entry == NULL)
+			break;
+		if (pg_atomic_read_u32(&entry->usage) != 0)
+			pg_atomic_write_u32(&entry->usage, 0);
+		else
+		{
+			smgrsizecache_remove(partition, entry);
+			break;
+		}
+	}
+
+	entry = (SMgrSizeCacheEntry *)
+		hash_search_with_hash_value(SMgrSizeCache, key, hashcode,
+									HASH_ENTER_NULL, &found);
+	/* out of shared memory is not a problem, we just don't cache the size */
+	if (entry == NULL)
+		return;
+	Assert(!found);
+
+	pg_atomic_init_u32(&entry->nblocks, nblocks);
+	pg_atomic_init_u32(&entry->usage, 1);
+	entry->slot = slot;
+	partition->slots[slot] = entry;
+}
+
+/*
+ * smgrsizecache_remove() -- Remove an entry from the size cache.
+ *
+ * The caller must hold the partition lock in exclusive mode.
+ */
+static void
+smgrsizecache_remove(SMgrSizeCachePartition *partition,
+					 SMgrSizeCacheEntry *entry)
+{
+	Assert(partition->slots[entry->slot] == entry);
+	partition->slots[entry->slot] = NULL;
+
+	/* a lookup that is reading the size from the file mustn't enter it */
+	pg_atomic_fetch_add_u32(&partition->changes, 1);
+
+	(void) hash_search(SMgrSizeCache, &entry->key, HASH_REMOVE, NULL);
+}
+
+/*
+ * smgrsizecache_update() -- Update the cached size of a fork, if it's cached.
+ *
+ * On extension ('extend' is true), the size is only ever advanced.
+ * Otherwise the fork was truncated, and 'nblocks' is its new size.
+ */
+static void
+smgrsizecache_update(SMgrRelation reln, ForkNumber forknum,
+					 BlockNumber nblocks, bool extend)
+{
+	SMgrSizeCacheKey key;
+	SMgrSizeCacheEntry *entry;
+	SMgrSizeCachePartition *partition;
+	LWLock	   *partitionLock;
+	uint32		hashcode;
+
+	if (!SMgrSizeCacheEnabled(reln->smgr_rnode))
+		return;
+
+	MemSet(&key, 0, sizeof(key));
+	key.rnode = reln->smgr_rnode.node;
+	key.forknum = forknum;
+
+	hashcode = get_hash_value(SMgrSizeCache, &key);
+	partition = SMgrSizeCachePartitionByIndex(SMgrSizeCacheHashPartition(hashcode));
+	partitionLock = SMgrSizeCachePartitionLockByIndex(SMgrSizeCacheHashPartition(hashcode));
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (SMgrSizeCacheEntry *)
+		hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+									HASH_FIND, NULL);
+	if (entry)
+	{
+		if (extend)
+		{
+			uint32		oldval = pg_atomic_read_u32(&entry->nblocks);
+
+			while (oldval < nblocks)
+			{
+				if (pg_atomic_compare_exchange_u32(&entry->nblocks,
+												   &oldval, nblocks))
+					break;
+			}
+		}
+		else
+			pg_atomic_write_u32(&entry->nblocks, nblocks);
+	}
+	else
+		pg_atomic_fetch_add_u32(&partition->changes, 1);
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * smgrsizecache_forget() -- Remove a fork, or all forks if 'forknum' is
+ *		InvalidForkNumber, of a relation from the size cache.
+ */
+static void
+smgrsizecache_forget(RelFileNodeBackend rnode, ForkNumber forknum)
+{
+	SMgrSizeCacheKey key;
+	ForkNumber	fork;
+
+	if (!SMgrSizeCacheEnabled(rnode))
+		return;
+
+	MemSet(&key, 0, sizeof(key));
+	key.rnode = rnode.node;
+
+	for (fork = 0; fork <= MAX_FORKNUM; fork++)
+	{
+		SMgrSizeCacheEntry *entry;
+		SMgrSizeCachePartition *partition;
+		LWLock	   *partitionLock;
+		uint32		hashcode;
+
+		if (forknum != InvalidForkNumber && fork != forknum)
+			continue;
+		key.forknum = fork;
+
+		hashcode = get_hash_value(SMgrSizeCache, &key);
+		partition = SMgrSizeCachePartitionByIndex(SMgrSizeCacheHashPartition(hashcode));
+		partitionLock = SMgrSizeCachePartitionLockByIndex(SMgrSizeCacheHashPartition(hashcode));
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		entry = (SMgrSizeCacheEntry *)
+			hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+										HASH_FIND, NULL);
+		if (entry)
+			smgrsizecache_remove(partition, entry);
+		else
+			pg_atomic_fetch_add_u32(&partition->changes, 1);
+		LWLockRelease(partitionLock);
+	}
+}
+
+/*
+ *	smgrdropdbsizes() -- Forget the cached sizes of all relations in a
+ *						 database.
+ *
+ *		This must be called when the files of a database are removed or
+ *		copied outside the storage manager, i.e. when the database is dropped
+ *		or moved to another tablespace.  InvalidOid forgets everything.
+ */
+void
+smgrdropdbsizes(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SMgrSizeCacheEntry *entry;
+	int			i;
+
+	if (SMgrSizeCache == NULL)
+		return;
+
+	/* lock all the partitions, in order, like GetLockStatusData() does */
+	for (i = 0; i < NUM_RELSIZE_CACHE_PARTITIONS; i++)
+		LWLockAcquire(SMgrSizeCachePartitionLockByIndex(i), LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SMgrSizeCache);
+	while ((entry = (SMgrSizeCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (dbid == InvalidOid || entry->key.rnode.dbNode == dbid)
+		{
+			uint32		hashcode = get_hash_value(SMgrSizeCache, &entry->key);
+
+			smgrsizecache_remove(SMgrSizeCachePartitionByIndex(SMgrSizeCacheHashPartition(hashcode)),
+								 entry);
+		}
+	}
+
+	/* the files of relations that weren't cached changed, too */
+	for (i = 0; i < NUM_RELSIZE_CACHE_PARTITIONS; i++)
+		pg_atomic_fetch_add_u32(&SMgrSizeCachePartitionByIndex(i)->changes, 1);
+
+	for (i = NUM_RELSIZE_CACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(SMgrSizeCachePartitionLockByIndex(i));
+}
+
 /*
  * AtEOXact_SMgr
  *
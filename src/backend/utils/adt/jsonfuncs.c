@@ -16,6 +16,7 @@
 
 #include <limits.h>
 
+#include "access/detoast.h"
 #include "access/htup_details.h"
 #include "catalog/pg_type.h"
 #include "fmgr.h"
@@ -689,6 +690,111 @@ okeys_scalar(void *state, char *token, JsonTokenType tokentype)
  * and the json{b?}_extract_path*(json, text, ...) functions
  */
 
+/*
+ * Cache of the most recently detoasted out-of-line jsonb document.
+ *
+ * Queries often extract many fields from the same document, as in
+ * "SELECT doc->'a', doc->'b', doc->>'c', ...".  Each of those operators gets
+ * the document as a separate argument, so if it's stored out of line, each
+ * would fetch and decompress all of it again.  To avoid that, the jsonb
+ * getters remember the last such document they detoasted, identified by its
+ * TOAST pointer, which can't refer to different data during one query.
+ *
+ * There is one cache per function memory context, so that queries running
+ * at the same time (e.g. a query and one nested in it via a SQL function)
+ * don't evict each other's documents.  Each cache lives in its context, and
+ * is unlinked from the list when that is reset or deleted.
+ */
+typedef struct JsonbDetoastCache
+{
+	struct JsonbDetoastCache *next;
+	MemoryContext mcxt;			/* context holding this struct and value */
+	Oid			toastrelid;		/* identity of the cached value */
+	Oid			valueid;
+	Jsonb	   *value;			/* detoasted document, or NULL */
+	MemoryContextCallback cb;	/* forgets the cache when mcxt is reset */
+} JsonbDetoastCache;
+
+static JsonbDetoastCache *jsonb_detoast_caches = NULL;
+
+static void
+jsonb_detoast_cache_reset(void *arg)
+{
+	JsonbDetoastCache **prev = &jsonb_detoast_caches;
+
+	while (*prev != NULL)
+	{
+		if (*prev == (JsonbDetoastCache *) arg)
+		{
+			*prev = (*prev)->next;
+			break;
+		}
+		prev = &(*prev)->next;
+	}
+}
+
+/*
+ * Get jsonb argument 'argno', through the detoast cache if it's stored out
+ * of line.  *cached is set if the result belongs to the cache, in which case
+ * the caller mustn't modify it or return it as its result.
+ */
+static Jsonb *
+jsonb_getarg_cached(FunctionCallInfo fcinfo, int argno, bool *cached)
+{
+	struct varlena *attr = (struct varlena *) PG_GETARG_POINTER(argno);
+	struct varatt_external toast_pointer;
+	JsonbDetoastCache *cache;
+	MemoryContext mcxt;
+	MemoryContext oldcxt;
+
+	*cached = false;
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr) || fcinfo->flinfo == NULL)
+		return DatumGetJsonbP(PointerGetDatum(attr));
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+	mcxt = fcinfo->flinfo->fn_mcxt;
+
+	for (cache = jsonb_detoast_caches; cache != NULL; cache = cache->next)
+	{
+		if (cache->mcxt == mcxt)
+			break;
+	}
+
+	if (cache == NULL)
+	{
+		cache = MemoryContextAllocZero(mcxt, sizeof(JsonbDetoastCache));
+		cache->mcxt = mcxt;
+		cache->cb.func = jsonb_detoast_cache_reset;
+		cache->cb.arg = cache;
+		MemoryContextRegisterResetCallback(mcxt, &cache->cb);
+		cache->next = jsonb_detoast_caches;
+		jsonb_detoast_caches = cache;
+	}
+	else if (cache->value != NULL &&
+			 cache->toastrelid == toast_pointer.va_toastrelid &&
+			 cache->valueid == toast_pointer.va_valueid)
+	{
+		*cached = true;
+		return cache->value;
+	}
+
+	/* Replace the previously cached document, if any */
+	if (cache->value != NULL)
+	{
+		pfree(cache->value);
+		cache->value = NULL;
+	}
+
+	oldcxt = MemoryContextSwitchTo(mcxt);
+	cache->value = (Jsonb *) detoast_attr(attr);
+	MemoryContextSwitchTo(oldcxt);
+	cache->toastrelid = toast_pointer.va_toastrelid;
+	cache->valueid = toast_pointer.va_valueid;
+
+	*cached = true;
+	return cache->value;
+}
+
 
 Datum
 json_object_field(PG_FUNCTION_ARGS)
@@ -709,7 +815,8 @@ json_object_field(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	bool		cached;
+	Jsonb	   *jb = jsonb_getarg_cached(fcinfo, 0, &cached);
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
 	JsonbValue	vbuf;
@@ -747,7 +854,8 @@ json_object_field_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	bool		cached;
+	Jsonb	   *jb = jsonb_getarg_cached(fcinfo, 0, &cached);
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
 	JsonbValue	vbuf;
@@ -784,7 +892,8 @@ json_array_element(PG_FUNCTION_ARGS)
 Datum
 jsonb_array_element(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	bool		cached;
+	Jsonb	   *jb = jsonb_getarg_cached(fcinfo, 0, &cached);
 	int			element = PG_GETARG_INT32(1);
 	JsonbValue *v;
 
@@ -827,7 +936,8 @@ json_array_element_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_array_element_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	bool		cached;
+	Jsonb	   *jb = jsonb_getarg_cached(fcinfo, 0, &cached);
 	int			element = PG_GETARG_INT32(1);
 	JsonbValue *v;
 
@@ -1324,7 +1434,8 @@ jsonb_extract_path_text(PG_FUNCTION_ARGS)
 static Datum
 get_jsonb_path_all(FunctionCallInfo fcinfo, bool as_text)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	bool		cached;
+	Jsonb	   *jb = jsonb_getarg_cached(fcinfo, 0, &cached);
 	ArrayType  *path = PG_GETARG_ARRAYTYPE_P(1);
 	Datum	   *pathtext;
 	bool	   *pathnulls;
@@ -1383,6 +1494,13 @@ get_jsonb_path_all(FunctionCallInfo fcinfo, bool as_text)
 		else
 		{
 			/* not text mode - just hand back the jsonb */
+			if (cached)
+			{
+				Jsonb	   *copy = palloc(VARSIZE(jb));
+
+				memcpy(copy, jb, VARSIZE(jb));
+				jb = copy;
+			}
 			PG_RETURN_JSONB_P(jb);
 		}
 	}
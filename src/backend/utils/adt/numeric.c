@@ -323,6 +323,15 @@ typedef struct
  * have the same weight and scale.  In accum_sum_final(), the positive and
  * negative sums are added together to produce the final result.
  *
+ * On platforms with 128-bit integers, values that can be represented exactly
+ * as a 64-bit integer scaled by a power of ten (which covers the values of
+ * most numeric(p,s) columns used for money and the like) are instead added
+ * to 'fast_sum', a 128-bit integer holding the sum scaled by 10^fast_scale.
+ * That avoids the per-digit work, and the buffers entirely if all inputs
+ * qualify.  'fast_scale' grows to the largest dscale of such values, as long
+ * as 'fast_sum' still fits; values that don't qualify are added to the digit
+ * buffers as described below.  accum_sum_final() adds the two sums.
+ *
  * When a new value has a larger ndigits or weight than the accumulator
  * currently does, the accumulator is enlarged to accommodate the new value.
  * We normally have one zero digit reserved for carry propagation, and that
@@ -345,8 +354,22 @@ typedef struct NumericSumAccum
 	bool		have_carry_space;
 	int32	   *pos_digits;
 	int32	   *neg_digits;
+#ifdef HAVE_INT128
+	int128		fast_sum;
+	int			fast_scale;
+#endif
 } NumericSumAccum;
 
+#ifdef HAVE_INT128
+/*
+ * Largest scale we use for NumericSumAccum's fast_sum, and the magnitude
+ * beyond which we move fast_sum into the digit buffers.  The latter leaves
+ * enough headroom that adding any int64 can't overflow.
+ */
+#define NUMERIC_FAST_SUM_MAX_SCALE	18
+#define NUMERIC_FAST_SUM_LIMIT		(((int128) 1) << 126)
+#endif
+
 
 /*
  * We define our own macros for packing and unpacking abbreviated-key
@@ -485,6 +508,10 @@ static void int64_to_numericvar(int64 val, NumericVar *var);
 #ifdef HAVE_INT128
 static bool numericvar_to_int128(const NumericVar *var, int128 *result);
 static void int128_to_numericvar(int128 val, NumericVar *var);
+static bool numericvar_to_scaled_int64(const NumericVar *var, int scale,
+									   int64 *result);
+static void scaled_int128_to_numericvar(int128 val, int scale,
+										NumericVar *var);
 #endif
 static double numeric_to_double_no_overflow(Numeric num);
 static double numericvar_to_double_no_overflow(const NumericVar *var);
@@ -548,6 +575,10 @@ static void compute_bucket(Numeric operand, Numeric bound1, Numeric bound2,
 						   const NumericVar *count_var, NumericVar *result_var);
 
 static void accum_sum_add(NumericSumAccum *accum, const NumericVar *var1);
+static void accum_sum_add_digits(NumericSumAccum *accum, const NumericVar *val);
+#ifdef HAVE_INT128
+static bool accum_sum_add_fast(NumericSumAccum *accum, const NumericVar *val);
+#endif
 static void accum_sum_rescale(NumericSumAccum *accum, const NumericVar *val);
 static void accum_sum_carry(NumericSumAccum *accum);
 static void accum_sum_reset(NumericSumAccum *accum);
@@ -6671,6 +6702,100 @@ int128_to_numericvar(int128 val, NumericVar *var)
 	var->ndigits = ndigits;
 	var->weight = ndigits - 1;
 }
+
+/*
+ * Convert numeric to a 64-bit integer scaled by 10^scale, without rounding.
+ *
+ * Return false if var has more than 'scale' decimal digits, or if the result
+ * would overflow (no error is raised).  Return true if okay.
+ */
+static bool
+numericvar_to_scaled_int64(const NumericVar *var, int scale, int64 *result)
+{
+	NumericDigit *digits = var->digits;
+	int			ndigits = var->ndigits;
+	int			exponent;
+	int			i;
+	int64		val;
+
+	if (var->dscale > scale)
+		return false;
+
+	if (ndigits == 0)
+	{
+		*result = 0;
+		return true;
+	}
+
+	/*
+	 * Read the digits as an integer, then adjust it by the power of ten that
+	 * both the position of the last digit and the requested scale call for.
+	 * Dividing is exact, since digits beyond dscale are always zero.  As in
+	 * numericvar_to_int64, accumulate a negative number so that we can
+	 * represent PG_INT64_MIN.
+	 */
+	val = 0;
+	for (i = 0; i < ndigits; i++)
+	{
+		if (unlikely(pg_mul_s64_overflow(val, NBASE, &val)) ||
+			unlikely(pg_sub_s64_overflow(val, digits[i], &val)))
+			return false;
+	}
+
+	exponent = (var->weight - ndigits + 1) * DEC_DIGITS + scale;
+	for (; exponent > 0; exponent--)
+	{
+		if (unlikely(pg_mul_s64_overflow(val, 10, &val)))
+			return false;
+	}
+	for (; exponent < 0; exponent++)
+	{
+		Assert(val % 10 == 0);
+		val /= 10;
+	}
+
+	if (var->sign == NUMERIC_POS)
+	{
+		if (unlikely(val == PG_INT64_MIN))
+			return false;
+		val = -val;
+	}
+	*result = val;
+
+	return true;
+}
+
+/*
+ * Convert a 128-bit integer scaled by 10^scale to numeric, with dscale
+ * 'scale'.
+ */
+static void
+scaled_int128_to_numericvar(int128 val, int scale, NumericVar *var)
+{
+	NumericDigit digit;
+	NumericVar	ten_pow;
+	int			exponent;
+	int			i;
+
+	int128_to_numericvar(val, var);
+	if (scale == 0)
+		return;
+
+	/* Multiply by 10^-scale, which is a single digit with a negative weight */
+	exponent = (scale + DEC_DIGITS - 1) / DEC_DIGITS;
+	digit = 1;
+	for (i = exponent * DEC_DIGITS - scale; i > 0; i--)
+		digit *= 10;
+
+	init_var(&ten_pow);
+	ten_pow.ndigits = 1;
+	ten_pow.weight = -exponent;
+	ten_pow.sign = NUMERIC_POS;
+	ten_pow.dscale = scale;
+	ten_pow.digits = &digit;
+
+	mul_var(var, &ten_pow, var, scale);
+}
 #endif
 
 /*
@@ -9167,6 +9292,10 @@ accum_sum_reset(NumericSumAccum *accum)
 		accum->pos_digits[i] = 0;
 		accum->neg_digits[i] = 0;
 	}
+#ifdef HAVE_INT128
+	accum->fast_sum = 0;
+	accum->fast_scale = 0;
+#endif
 }
 
 /*
@@ -9174,6 +9303,79 @@ accum_sum_reset(NumericSumAccum *accum)
  */
 static void
 accum_sum_add(NumericSumAccum *accum, const NumericVar *val)
+{
+#ifdef HAVE_INT128
+	if (accum_sum_add_fast(accum, val))
+		return;
+#endif
+	accum_sum_add_digits(accum, val);
+}
+
+#ifdef HAVE_INT128
+/*
+ * Try to add a new value to the accumulator's fast_sum.
+ *
+ * Returns false if the value can't be represented at a scale fast_sum can
+ * use, in which case the caller must add it to the digit buffers instead.
+ */
+static bool
+accum_sum_add_fast(NumericSumAccum *accum, const NumericVar *val)
+{
+	int			scale = accum->fast_scale;
+	int64		ival;
+	int			i;
+
+	/* Would fast_sum need to switch to a larger scale for this value? */
+	if (val->dscale > scale)
+	{
+		int128		limit = NUMERIC_FAST_SUM_LIMIT;
+
+		if (val->dscale > NUMERIC_FAST_SUM_MAX_SCALE)
+			return false;
+		for (i = scale; i < val->dscale; i++)
+			limit /= 10;
+		if (accum->fast_sum > limit || accum->fast_sum < -limit)
+			return false;
+		scale = val->dscale;
+	}
+
+	if (!numericvar_to_scaled_int64(val, scale, &ival))
+		return false;
+
+	for (i = accum->fast_scale; i < scale; i++)
+		accum->fast_sum *= 10;
+	accum->fast_scale = scale;
+	accum->fast_sum += ival;
+
+	if (val->dscale > accum->dscale)
+		accum->dscale = val->dscale;
+
+	/*
+	 * Move the sum into the digit buffers once it gets large enough that
+	 * the next addition might overflow it.
+	 */
+	if (accum->fast_sum > NUMERIC_FAST_SUM_LIMIT ||
+		accum->fast_sum < -NUMERIC_FAST_SUM_LIMIT)
+	{
+		NumericVar	tmp_var;
+
+		init_var(&tmp_var);
+		scaled_int128_to_numericvar(accum->fast_sum, accum->fast_scale,
+									&tmp_var);
+		accum->fast_sum = 0;
+		accum_sum_add_digits(accum, &tmp_var);
+		free_var(&tmp_var);
+	}
+
+	return true;
+}
+#endif
+
+/*
+ * Accumulate a new value into the digit buffers.
+ */
+static void
+accum_sum_add_digits(NumericSumAccum *accum, const NumericVar *val)
 {
 	int32	   *accum_digits;
 	int			i,
@@ -9390,38 +9592,54 @@ accum_sum_final(NumericSumAccum *accum, NumericVar *result)
 	NumericVar	neg_var;
 
 	if (accum->ndigits == 0)
-	{
 		set_var_from_var(&const_zero, result);
-		return;
-	}
+	else
+	{
+		/* Perform final carry */
+		accum_sum_carry(accum);
 
-	/* Perform final carry */
-	accum_sum_carry(accum);
+		/* Create NumericVars representing the positive and negative sums */
+		init_var(&pos_var);
+		init_var(&neg_var);
 
-	/* Create NumericVars representing the positive and negative sums */
-	init_var(&pos_var);
-	init_var(&neg_var);
+		pos_var.ndigits = neg_var.ndigits = accum->ndigits;
+		pos_var.weight = neg_var.weight = accum->weight;
+		pos_var.dscale = neg_var.dscale = accum->dscale;
+		pos_var.sign = NUMERIC_POS;
+		neg_var.sign = NUMERIC_NEG;
 
-	pos_var.ndigits = neg_var.ndigits = accum->ndigits;
-	pos_var.weight = neg_var.weight = accum->weight;
-	pos_var.dscale = neg_var.dscale = accum->dscale;
-	pos_var.sign = NUMERIC_POS;
-	neg_var.sign = NUMERIC_NEG;
+		pos_var.buf = pos_var.digits = digitbuf_alloc(accum->ndigits);
+		neg_var.buf = neg_var.digits = digitbuf_alloc(accum->ndigits);
 
-	pos_var.buf = pos_var.digits = digitbuf_alloc(accum->ndigits);
-	neg_var.buf = neg_var.digits = digitbuf_alloc(accum->ndigits);
+		for (i = 0; i < accum->ndigits; i++)
+		{
+			Assert(accum->pos_digits[i] < NBASE);
+			pos_var.digits[i] = (int16) accum->pos_digits[i];
 
-	for (i = 0; i < accum->ndigits; i++)
+			Assert(accum->neg_digits[i] < NBASE);
+			neg_var.digits[i] = (int16) accum->neg_digits[i];
+		}
+
+		/* And add them together */
+		add_var(&pos_var, &neg_var, result);
+	}
+
+#ifdef HAVE_INT128
+	/* Add in the fast sum, if any */
+	if (accum->fast_sum != 0)
 	{
-		Assert(accum->pos_digits[i] < NBASE);
-		pos_var.digits[i] = (int16) accum->pos_digits[i];
+		NumericVar	fast_var;
 
-		Assert(accum->neg_digits[i] < NBASE);
-		neg_var.digits[i] = (int16) accum->neg_digits[i];
+		init_var(&fast_var);
+		scaled_int128_to_numericvar(accum->fast_sum, accum->fast_scale,
+									&fast_var);
+		add_var(result, &fast_var, result);
+		free_var(&fast_var);
 	}
 
-	/* And add them together */
-	add_var(&pos_var, &neg_var, result);
+	/* The inputs summed in fast_sum may have had a larger dscale */
+	result->dscale = accum->dscale;
+#endif
 
 	/* Remove leading/trailing zeroes */
 	strip_var(result);
@@ -9445,6 +9663,10 @@ accum_sum_copy(NumericSumAccum *dst, NumericSumAccum *src)
 	dst->ndigits = src->ndigits;
 	dst->weight = src->weight;
 	dst->dscale = src->dscale;
+#ifdef HAVE_INT128
+	dst->fast_sum = src->fast_sum;
+	dst->fast_scale = src->fast_scale;
+#endif
 }
 
 /*
@@ -63,6 +63,12 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC parameter: seconds an unused entry survives before it may be pruned */
+int			catalog_cache_prune_min_age = 300;
+
+/* Timestamp used to record catcache entry accesses */
+TimestampTz catcacheclock = 0;
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
@@ -891,6 +897,59 @@ RehashCatCache(CatCache *cp)
 	cp->cc_bucket = newbucket;
 }
 
+/*
+ * Remove entries that have not been used for catalog_cache_prune_min_age
+ * seconds, so that a backend that has touched many catalog objects once
+ * does not keep them cached forever.
+ *
+ * This is called when the cache is about to be enlarged.  Returns true if
+ * enough entries were removed that enlarging is no longer necessary.  We
+ * require the fill factor to drop well below the enlargement threshold, so
+ * that the cache is not rescanned on each of the following insertions.
+ */
+static bool
+CatCacheCleanupOldEntries(CatCache *cp)
+{
+	TimestampTz prune_threshold;
+	int			nremoved = 0;
+	int			i;
+
+	/* Pruning is disabled, or the clock has not been started yet */
+	if (catalog_cache_prune_min_age < 0 || catcacheclock == 0)
+		return false;
+
+	prune_threshold = catcacheclock -
+		(TimestampTz) catalog_cache_prune_min_age * USECS_PER_SEC;
+
+	for (i = 0; i < cp->cc_nbuckets; i++)
+	{
+		dlist_mutable_iter iter;
+
+		dlist_foreach_modify(iter, &cp->cc_bucket[i])
+		{
+			CatCTup    *ct = dlist_container(CatCTup, cache_elem, iter.cur);
+
+			/*
+			 * Entries in use can't be removed.  Neither can list members,
+			 * since that would take the whole list with them.
+			 */
+			if (ct->refcount > 0 || ct->c_list != NULL)
+				continue;
+
+			if (ct->lastaccess < prune_threshold)
+			{
+				CatCacheRemoveCTup(cp, ct);
+				nremoved++;
+			}
+		}
+	}
+
+	elog(DEBUG1, "pruned %d entries from catalog cache id %d for %s; %d tups, %d buckets",
+		 nremoved, cp->id, cp->cc_relname, cp->cc_ntup, cp->cc_nbuckets);
+
+	return cp->cc_ntup <= cp->cc_nbuckets * 3 / 2;
+}
+
 /*
  *		CatalogCacheInitializeCache
  *
@@ -1264,6 +1323,9 @@ SearchCatCacheInternal(CatCache *cache,
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
 
+		/* Record the access, so that pruning leaves this entry alone */
+		ct->lastaccess = catcacheclock;
+
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
 		 * negative, we can report failure to the caller.
@@ -1887,6 +1949,7 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	ct->refcount = 0;			/* for the moment */
 	ct->dead = false;
 	ct->negative = negative;
+	ct->lastaccess = catcacheclock;
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
@@ -1896,9 +1959,11 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
-	 * arbitrarily, we enlarge when fill factor > 2.
+	 * arbitrarily, we enlarge when fill factor > 2.  First try to make room
+	 * by removing entries that haven't been used for a while, though.
 	 */
-	if (cache->cc_ntup > cache->cc_nbuckets * 2)
+	if (cache->cc_ntup > cache->cc_nbuckets * 2 &&
+		!CatCacheCleanupOldEntries(cache))
 		RehashCatCache(cache);
 
 	return ct;
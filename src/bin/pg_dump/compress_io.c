@@ -13,7 +13,9 @@
  * friends, providing an interface similar to those, but abstracts away
  * the possible compression. Both APIs use libz for the compression, but
  * the second API uses gzip headers, so the resulting files can be easily
- * manipulated with the gzip utility.
+ * manipulated with the gzip utility. The second API can also write LZ4
+ * frames instead, if built with LZ4 support; those files can be handled
+ * with the lz4 utility.
  *
  * Compressor API
  * --------------
@@ -41,10 +43,10 @@
  *	libz's gzopen() APIs. It allows you to use the same functions for
  *	compressed and uncompressed streams. cfopen_read() first tries to open
  *	the file with given name, and if it fails, it tries to open the same
- *	file with the .gz suffix. cfopen_write() opens a file for writing, an
- *	extra argument specifies if the file should be compressed, and adds the
- *	.gz suffix to the filename if so. This allows you to easily handle both
- *	compressed and uncompressed files.
+ *	file with the .gz and .lz4 suffixes. cfopen_write() opens a file for
+ *	writing, extra arguments specify if and how the file should be
+ *	compressed, and add the .gz or .lz4 suffix to the filename if so. This
+ *	allows you to easily handle both compressed and uncompressed files.
  *
  * IDENTIFICATION
  *	   src/bin/pg_dump/compress_io.c
@@ -56,6 +58,10 @@
 #include "compress_io.h"
 #include "pg_backup_utils.h"
 
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+
 /*----------------------
  * Compressor API
  *----------------------
@@ -191,6 +197,10 @@ WriteDataToArchive(ArchiveHandle *AH, CompressorState *cs,
 		case COMPR_ALG_NONE:
 			WriteDataToArchiveNone(AH, cs, data, dLen);
 			break;
+		case COMPR_ALG_LZ4:
+			/* only the compressed stream API knows about LZ4 */
+			fatal("invalid compression algorithm for archive stream");
+			break;
 	}
 	return;
 }
@@ -416,6 +426,32 @@ WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
  *----------------------
  */
 
+#ifdef USE_LZ4
+/*
+ * State of an LZ4 frame stream.  The underlying file is the cfp's
+ * uncompressedfp; 'buf' holds compressed data on its way to or from it.
+ */
+typedef struct LZ4State
+{
+	bool		compressing;	/* opened for writing? */
+	LZ4F_compressionContext_t cctx;
+	LZ4F_decompressionContext_t dctx;
+	LZ4F_preferences_t prefs;
+
+	char	   *buf;			/* compressed data */
+	size_t		buflen;			/* allocated size of buf */
+	size_t		bufused;		/* bytes of input in buf (reading only) */
+	size_t		bufnext;		/* next unconsumed input byte in buf */
+
+	char	   *out;			/* decompressed data (reading only) */
+	size_t		outused;		/* bytes of decompressed data in out */
+	size_t		outnext;		/* next byte of out to return */
+
+	bool		eof;			/* reached end of underlying file? */
+	const char *errmsg;			/* last LZ4 error, for get_cfp_error() */
+} LZ4State;
+#endif
+
 /*
  * cfp represents an open stream, wrapping the underlying FILE or gzFile
  * pointer. This is opaque to the callers.
@@ -426,12 +462,23 @@ struct cfp
 #ifdef HAVE_LIBZ
 	gzFile		compressedfp;
 #endif
+#ifdef USE_LZ4
+	LZ4State   *lz4;			/* if not NULL, uncompressedfp holds LZ4 */
+#endif
 };
 
-#ifdef HAVE_LIBZ
+#if defined(HAVE_LIBZ) || defined(USE_LZ4)
 static int	hasSuffix(const char *filename, const char *suffix);
 #endif
 
+#ifdef USE_LZ4
+static bool LZ4StreamOpen(cfp *fp, const char *mode, int compression);
+static int	LZ4StreamWrite(const void *ptr, int size, cfp *fp);
+static bool LZ4StreamFill(cfp *fp);
+static int	LZ4StreamRead(void *ptr, int size, cfp *fp);
+static int	LZ4StreamClose(cfp *fp);
+#endif
+
 /* free() without changing errno; useful in several places below */
 static void
 free_keep_errno(void *p)
@@ -447,8 +494,9 @@ free_keep_errno(void *p)
  * be either "r" or "rb".
  *
  * If the file at 'path' does not exist, we append the ".gz" suffix (if 'path'
- * doesn't already have it) and try again. So if you pass "foo" as 'path',
- * this will open either "foo" or "foo.gz".
+ * doesn't already have it) and try again, and then the ".lz4" suffix. So if
+ * you pass "foo" as 'path', this will open either "foo", "foo.gz" or
+ * "foo.lz4".
  *
  * On failure, return NULL with an error code in errno.
  */
@@ -459,18 +507,33 @@ cfopen_read(const char *path, const char *mode)
 
 #ifdef HAVE_LIBZ
 	if (hasSuffix(path, ".gz"))
-		fp = cfopen(path, mode, 1);
+		fp = cfopen(path, mode, COMPR_ALG_LIBZ, 1);
+	else
+#endif
+#ifdef USE_LZ4
+	if (hasSuffix(path, ".lz4"))
+		fp = cfopen(path, mode, COMPR_ALG_LZ4, 1);
 	else
 #endif
 	{
-		fp = cfopen(path, mode, 0);
+		fp = cfopen(path, mode, COMPR_ALG_NONE, 0);
 #ifdef HAVE_LIBZ
 		if (fp == NULL)
 		{
 			char	   *fname;
 
 			fname = psprintf("%s.gz", path);
-			fp = cfopen(fname, mode, 1);
+			fp = cfopen(fname, mode, COMPR_ALG_LIBZ, 1);
+			free_keep_errno(fname);
+		}
+#endif
+#ifdef USE_LZ4
+		if (fp == NULL)
+		{
+			char	   *fname;
+
+			fname = psprintf("%s.lz4", path);
+			fp = cfopen(fname, mode, COMPR_ALG_LZ4, 1);
 			free_keep_errno(fname);
 		}
 #endif
@@ -483,26 +546,41 @@ cfopen_read(const char *path, const char *mode)
  * be a filemode as accepted by fopen() and gzopen() that indicates writing
  * ("w", "wb", "a", or "ab").
  *
- * If 'compression' is non-zero, a gzip compressed stream is opened, and
- * 'compression' indicates the compression level used. The ".gz" suffix
- * is automatically added to 'path' in that case.
+ * If 'compression' is non-zero, a compressed stream is opened, and
+ * 'compression' indicates the compression level used. 'alg' selects
+ * between a gzip stream, with the ".gz" suffix automatically added to
+ * 'path', and an LZ4 frame stream, with the ".lz4" suffix.
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
-cfopen_write(const char *path, const char *mode, int compression)
+cfopen_write(const char *path, const char *mode,
+			 CompressionAlgorithm alg, int compression)
 {
 	cfp		   *fp;
 
-	if (compression == 0)
-		fp = cfopen(path, mode, 0);
+	if (compression == 0 || alg == COMPR_ALG_NONE)
+		fp = cfopen(path, mode, COMPR_ALG_NONE, 0);
+	else if (alg == COMPR_ALG_LZ4)
+	{
+#ifdef USE_LZ4
+		char	   *fname;
+
+		fname = psprintf("%s.lz4", path);
+		fp = cfopen(fname, mode, alg, compression);
+		free_keep_errno(fname);
+#else
+		fatal("not built with LZ4 support");
+		fp = NULL;				/* keep compiler quiet */
+#endif
+	}
 	else
 	{
 #ifdef HAVE_LIBZ
 		char	   *fname;
 
 		fname = psprintf("%s.gz", path);
-		fp = cfopen(fname, mode, compression);
+		fp = cfopen(fname, mode, alg, compression);
 		free_keep_errno(fname);
 #else
 		fatal("not built with zlib support");
@@ -514,16 +592,44 @@ cfopen_write(const char *path, const char *mode, int compression)
 
 /*
  * Opens file 'path' in 'mode'. If 'compression' is non-zero, the file
- * is opened with libz gzopen(), otherwise with plain fopen().
+ * is opened with libz gzopen(), or as an LZ4 frame stream if 'alg' is
+ * COMPR_ALG_LZ4, otherwise with plain fopen().
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
-cfopen(const char *path, const char *mode, int compression)
+cfopen(const char *path, const char *mode,
+	   CompressionAlgorithm alg, int compression)
 {
 	cfp		   *fp = pg_malloc(sizeof(cfp));
 
-	if (compression != 0)
+#ifdef USE_LZ4
+	fp->lz4 = NULL;
+#endif
+
+	if (compression != 0 && alg == COMPR_ALG_LZ4)
+	{
+#ifdef USE_LZ4
+#ifdef HAVE_LIBZ
+		fp->compressedfp = NULL;
+#endif
+		fp->uncompressedfp = fopen(path, mode);
+		if (fp->uncompressedfp == NULL)
+		{
+			free_keep_errno(fp);
+			fp = NULL;
+		}
+		else if (!LZ4StreamOpen(fp, mode, compression))
+		{
+			fclose(fp->uncompressedfp);
+			free_keep_errno(fp);
+			fp = NULL;
+		}
+#else
+		fatal("not built with LZ4 support");
+#endif
+	}
+	else if (compression != 0)
 	{
 #ifdef HAVE_LIBZ
 		if (compression != Z_DEFAULT_COMPRESSION)
@@ -590,6 +696,11 @@ cfread(void *ptr, int size, cfp *fp)
 		}
 	}
 	else
+#endif
+#ifdef USE_LZ4
+	if (fp->lz4)
+		ret = LZ4StreamRead(ptr, size, fp);
+	else
 #endif
 	{
 		ret = fread(ptr, 1, size, fp->uncompressedfp);
@@ -606,6 +717,11 @@ cfwrite(const void *ptr, int size, cfp *fp)
 	if (fp->compressedfp)
 		return gzwrite(fp->compressedfp, ptr, size);
 	else
+#endif
+#ifdef USE_LZ4
+	if (fp->lz4)
+		return LZ4StreamWrite(ptr, size, fp);
+	else
 #endif
 		return fwrite(ptr, 1, size, fp->uncompressedfp);
 }
@@ -628,6 +744,15 @@ cfgetc(cfp *fp)
 		}
 	}
 	else
+#endif
+#ifdef USE_LZ4
+	if (fp->lz4)
+	{
+		if (!LZ4StreamFill(fp))
+			fatal("could not read from input file: end of file");
+		ret = (unsigned char) fp->lz4->out[fp->lz4->outnext++];
+	}
+	else
 #endif
 	{
 		ret = fgetc(fp->uncompressedfp);
@@ -645,6 +770,28 @@ cfgets(cfp *fp, char *buf, int len)
 	if (fp->compressedfp)
 		return gzgets(fp->compressedfp, buf, len);
 	else
+#endif
+#ifdef USE_LZ4
+	if (fp->lz4)
+	{
+		LZ4State   *state = fp->lz4;
+		int			i = 0;
+
+		/* like fgets(), stop after a newline or when the buffer is full */
+		while (i < len - 1 && LZ4StreamFill(fp))
+		{
+			char		c = state->out[state->outnext++];
+
+			buf[i++] = c;
+			if (c == '\n')
+				break;
+		}
+		if (i == 0)
+			return NULL;
+		buf[i] = '\0';
+		return buf;
+	}
+	else
 #endif
 		return fgets(buf, len, fp->uncompressedfp);
 }
@@ -666,6 +813,14 @@ cfclose(cfp *fp)
 		fp->compressedfp = NULL;
 	}
 	else
+#endif
+#ifdef USE_LZ4
+	if (fp->lz4)
+	{
+		result = LZ4StreamClose(fp);
+		fp->uncompressedfp = NULL;
+	}
+	else
 #endif
 	{
 		result = fclose(fp->uncompressedfp);
@@ -683,6 +838,11 @@ cfeof(cfp *fp)
 	if (fp->compressedfp)
 		return gzeof(fp->compressedfp);
 	else
+#endif
+#ifdef USE_LZ4
+	if (fp->lz4)
+		return fp->lz4->eof && fp->lz4->outnext == fp->lz4->outused;
+	else
 #endif
 		return feof(fp->uncompressedfp);
 }
@@ -699,11 +859,227 @@ get_cfp_error(cfp *fp)
 		if (errnum != Z_ERRNO)
 			return errmsg;
 	}
+#endif
+#ifdef USE_LZ4
+	if (fp->lz4 && fp->lz4->errmsg)
+		return fp->lz4->errmsg;
 #endif
 	return strerror(errno);
 }
 
-#ifdef HAVE_LIBZ
+#ifdef USE_LZ4
+/*
+ * Functions for LZ4 frame streams.
+ */
+
+/*
+ * Set up LZ4 (de)compression state for a freshly opened file.  When writing,
+ * the frame header is written immediately.  Returns false with errno set if
+ * writing the header fails.
+ */
+static bool
+LZ4StreamOpen(cfp *fp, const char *mode, int compression)
+{
+	LZ4State   *state = pg_malloc0(sizeof(LZ4State));
+	size_t		status;
+
+	state->compressing = (mode[0] == 'w' || mode[0] == 'a');
+
+	if (state->compressing)
+	{
+		/* zlib levels map onto LZ4 levels; 1-2 are fast, higher is LZ4HC */
+		if (compression != Z_DEFAULT_COMPRESSION)
+			state->prefs.compressionLevel = compression;
+
+		status = LZ4F_createCompressionContext(&state->cctx, LZ4F_VERSION);
+		if (LZ4F_isError(status))
+			fatal("could not initialize LZ4 compression: %s",
+				  LZ4F_getErrorName(status));
+
+		state->buflen = LZ4F_compressBound(LZ4_IN_SIZE, &state->prefs);
+		if (state->buflen < LZ4F_HEADER_SIZE_MAX)
+			state->buflen = LZ4F_HEADER_SIZE_MAX;
+		state->buf = pg_malloc(state->buflen);
+
+		status = LZ4F_compressBegin(state->cctx, state->buf, state->buflen,
+									&state->prefs);
+		if (LZ4F_isError(status))
+			fatal("could not compress data: %s", LZ4F_getErrorName(status));
+
+		errno = 0;
+		if (fwrite(state->buf, 1, status, fp->uncompressedfp) != status)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			LZ4F_freeCompressionContext(state->cctx);
+			free(state->buf);
+			free_keep_errno(state);
+			return false;
+		}
+	}
+	else
+	{
+		status = LZ4F_createDecompressionContext(&state->dctx, LZ4F_VERSION);
+		if (LZ4F_isError(status))
+			fatal("could not initialize LZ4 decompression: %s",
+				  LZ4F_getErrorName(status));
+
+		state->buflen = LZ4_IN_SIZE;
+		state->buf = pg_malloc(state->buflen);
+		state->out = pg_malloc(LZ4_OUT_SIZE);
+	}
+
+	fp->lz4 = state;
+	return true;
+}
+
+/*
+ * Compress 'size' bytes and write them out.  Returns the number of input
+ * bytes consumed, which is less than 'size' only on a write failure.
+ */
+static int
+LZ4StreamWrite(const void *ptr, int size, cfp *fp)
+{
+	LZ4State   *state = fp->lz4;
+	const char *src = ptr;
+	int			done = 0;
+
+	while (done < size)
+	{
+		size_t		chunk = Min(size - done, LZ4_IN_SIZE);
+		size_t		status;
+
+		status = LZ4F_compressUpdate(state->cctx, state->buf, state->buflen,
+									 src + done, chunk, NULL);
+		if (LZ4F_isError(status))
+		{
+			state->errmsg = LZ4F_getErrorName(status);
+			return done;
+		}
+
+		if (status > 0 &&
+			fwrite(state->buf, 1, status, fp->uncompressedfp) != status)
+			return done;
+
+		done += chunk;
+	}
+
+	return done;
+}
+
+/*
+ * Make sure there is decompressed data available in the output buffer.
+ * Returns false at end of file.
+ */
+static bool
+LZ4StreamFill(cfp *fp)
+{
+	LZ4State   *state = fp->lz4;
+
+	while (state->outnext == state->outused)
+	{
+		size_t		srcsize;
+		size_t		dstsize;
+		size_t		status;
+
+		if (state->bufnext == state->bufused)
+		{
+			if (state->eof)
+				return false;
+
+			state->bufused = fread(state->buf, 1, state->buflen,
+								   fp->uncompressedfp);
+			state->bufnext = 0;
+			if (state->bufused == 0)
+			{
+				if (ferror(fp->uncompressedfp))
+					READ_ERROR_EXIT(fp->uncompressedfp);
+				state->eof = true;
+				return false;
+			}
+		}
+
+		srcsize = state->bufused - state->bufnext;
+		dstsize = LZ4_OUT_SIZE;
+		status = LZ4F_decompress(state->dctx, state->out, &dstsize,
+								 state->buf + state->bufnext, &srcsize, NULL);
+		if (LZ4F_isError(status))
+			fatal("could not uncompress data: %s",
+				  LZ4F_getErrorName(status));
+
+		state->bufnext += srcsize;
+		state->outused = dstsize;
+		state->outnext = 0;
+	}
+
+	return true;
+}
+
+static int
+LZ4StreamRead(void *ptr, int size, cfp *fp)
+{
+	LZ4State   *state = fp->lz4;
+	char	   *dst = ptr;
+	int			done = 0;
+
+	while (done < size && LZ4StreamFill(fp))
+	{
+		size_t		n = Min(size - done, state->outused - state->outnext);
+
+		memcpy(dst + done, state->out + state->outnext, n);
+		state->outnext += n;
+		done += n;
+	}
+
+	return done;
+}
+
+/*
+ * Finish the LZ4 frame if writing, and close the underlying file.
+ */
+static int
+LZ4StreamClose(cfp *fp)
+{
+	LZ4State   *state = fp->lz4;
+	int			result = 0;
+
+	if (state->compressing)
+	{
+		size_t		status;
+
+		status = LZ4F_compressEnd(state->cctx, state->buf, state->buflen,
+								  NULL);
+		if (LZ4F_isError(status))
+			fatal("could not close compression stream: %s",
+				  LZ4F_getErrorName(status));
+
+		errno = 0;
+		if (fwrite(state->buf, 1, status, fp->uncompressedfp) != status)
+		{
+			if (errno == 0)
+				errno = ENOSPC;
+			result = EOF;
+		}
+		LZ4F_freeCompressionContext(state->cctx);
+	}
+	else
+		LZ4F_freeDecompressionContext(state->dctx);
+
+	if (fclose(fp->uncompressedfp) != 0)
+		result = EOF;
+
+	free(state->buf);
+	if (state->out)
+		free(state->out);
+	free_keep_errno(state);
+	fp->lz4 = NULL;
+
+	return result;
+}
+#endif							/* USE_LZ4 */
+
+#if defined(HAVE_LIBZ) || defined(USE_LZ4)
 static int
 hasSuffix(const char *filename, const char *suffix)
 {
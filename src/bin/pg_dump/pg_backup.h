@@ -171,6 +171,10 @@ typedef struct _dumpOptions
 
 	int			sequence_data;	/* dump sequence data even in schema-only mode */
 	int			do_nothing;
+	int			table_chunk_pages;	/* split table data into chunks of this
+									 * many pages, or 0 */
+	bool		compress_lz4;	/* compress data files with LZ4 (directory
+								 * format only) */
 } DumpOptions;
 
 /*
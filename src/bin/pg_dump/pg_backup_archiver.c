@@ -1869,7 +1869,29 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				fatal("bad table dumpId for TABLE DATA item");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			/*
+			 * If pg_dump split the table's data into several chunks, there
+			 * is more than one TABLE DATA item for it.  tableDataId points
+			 * to the first one, and the rest are chained to it through
+			 * nextDataChunk.
+			 */
+			te->nextDataChunk = 0;
+			if (AH->tableDataId[tableId] != 0)
+			{
+				TocEntry   *chunkte;
+
+				if (AH->version < K_VERS_1_15)
+					fatal("more than one TABLE DATA item for table with dumpId %d",
+						  tableId);
+
+				chunkte = AH->tocsByDumpId[AH->tableDataId[tableId]];
+
+				while (chunkte->nextDataChunk != 0)
+					chunkte = AH->tocsByDumpId[chunkte->nextDataChunk];
+				chunkte->nextDataChunk = te->dumpId;
+			}
+			else
+				AH->tableDataId[tableId] = te->dumpId;
 		}
 	}
 }
@@ -4643,9 +4665,11 @@ repoint_table_dependencies(ArchiveHandle *AH)
 
 	for (te = AH->toc->next; te != AH->toc; te = te->next)
 	{
+		int			nDeps = te->nDeps;
+
 		if (te->section != SECTION_POST_DATA)
 			continue;
-		for (i = 0; i < te->nDeps; i++)
+		for (i = 0; i < nDeps; i++)
 		{
 			olddep = te->dependencies[i];
 			if (olddep <= AH->maxDumpId &&
@@ -4658,6 +4682,21 @@ repoint_table_dependencies(ArchiveHandle *AH)
 				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				/* If the data was dumped in chunks, depend on all of them */
+				while (tabledatate->nextDataChunk != 0)
+				{
+					tabledataid = tabledatate->nextDataChunk;
+					tabledatate = AH->tocsByDumpId[tabledataid];
+
+					te->dependencies = (DumpId *)
+						pg_realloc(te->dependencies,
+								   (te->nDeps + 1) * sizeof(DumpId));
+					te->dependencies[te->nDeps++] = tabledataid;
+					te->dataLength = Max(te->dataLength, tabledatate->dataLength);
+					pg_log_debug("transferring dependency %d -> %d to %d",
+								 te->dumpId, olddep, tabledataid);
+				}
 			}
 		}
 	}
@@ -4779,7 +4818,12 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->created = true;
+		/*
+		 * If the data comes in several chunks, they are loaded independently
+		 * and none of them may truncate the table.
+		 */
+		if (ted->nextDataChunk == 0)
+			ted->created = true;
 	}
 }
 
@@ -4798,6 +4842,13 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
 		ted->reqs = 0;
+
+		/* likewise for any further chunks of the data */
+		while (ted->nextDataChunk != 0)
+		{
+			ted = AH->tocsByDumpId[ted->nextDataChunk];
+			ted->reqs = 0;
+		}
 	}
 }
 
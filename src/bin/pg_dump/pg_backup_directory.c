@@ -7,9 +7,10 @@
  *	Large objects (BLOBs) are stored in separate files named "blob_<uid>.dat",
  *	and there's a plain-text TOC file for them called "blobs.toc". If
  *	compression is used, each data file is individually compressed and the
- *	".gz" suffix is added to the filenames. The TOC files are never
- *	compressed by pg_dump, however they are accepted with the .gz suffix too,
- *	in case the user has manually compressed them with 'gzip'.
+ *	".gz" suffix is added to the filenames, or ".lz4" if LZ4 compression was
+ *	requested. The TOC files are never compressed by pg_dump, however they
+ *	are accepted with the .gz or .lz4 suffix too, in case the user has
+ *	manually compressed them with 'gzip' or 'lz4'.
  *
  *	NOTE: This format is identical to the files written in the tar file in
  *	the 'tar' format, except that we don't write the restore.sql file (TODO),
@@ -93,6 +94,7 @@ static int	_WorkerJobDumpDirectory(ArchiveHandle *AH, TocEntry *te);
 
 static void setFilePath(ArchiveHandle *AH, char *buf,
 						const char *relativeFilename);
+static CompressionAlgorithm _compressionAlgorithm(ArchiveHandle *AH);
 
 /*
  *	Init routine required by ALL formats. This is a global routine
@@ -327,7 +329,8 @@ _StartData(ArchiveHandle *AH, TocEntry *te)
 
 	setFilePath(AH, fname, tctx->filename);
 
-	ctx->dataFH = cfopen_write(fname, PG_BINARY_W, AH->compression);
+	ctx->dataFH = cfopen_write(fname, PG_BINARY_W, _compressionAlgorithm(AH),
+							   AH->compression);
 	if (ctx->dataFH == NULL)
 		fatal("could not open output file \"%s\": %m", fname);
 }
@@ -569,7 +572,7 @@ _CloseArchive(ArchiveHandle *AH)
 		ctx->pstate = ParallelBackupStart(AH);
 
 		/* The TOC is always created uncompressed */
-		tocFH = cfopen_write(fname, PG_BINARY_W, 0);
+		tocFH = cfopen_write(fname, PG_BINARY_W, COMPR_ALG_NONE, 0);
 		if (tocFH == NULL)
 			fatal("could not open output file \"%s\": %m", fname);
 		ctx->dataFH = tocFH;
@@ -632,7 +635,7 @@ _StartBlobs(ArchiveHandle *AH, TocEntry *te)
 	setFilePath(AH, fname, "blobs.toc");
 
 	/* The blob TOC file is never compressed */
-	ctx->blobsTocFH = cfopen_write(fname, "ab", 0);
+	ctx->blobsTocFH = cfopen_write(fname, "ab", COMPR_ALG_NONE, 0);
 	if (ctx->blobsTocFH == NULL)
 		fatal("could not open output file \"%s\": %m", fname);
 }
@@ -650,7 +653,8 @@ _StartBlob(ArchiveHandle *AH, TocEntry *te, Oid oid)
 
 	snprintf(fname, MAXPGPATH, "%s/blob_%u.dat", ctx->directory, oid);
 
-	ctx->dataFH = cfopen_write(fname, PG_BINARY_W, AH->compression);
+	ctx->dataFH = cfopen_write(fname, PG_BINARY_W, _compressionAlgorithm(AH),
+							   AH->compression);
 
 	if (ctx->dataFH == NULL)
 		fatal("could not open output file \"%s\": %m", fname);
@@ -714,6 +718,19 @@ setFilePath(ArchiveHandle *AH, char *buf, const char *relativeFilename)
 	strcat(buf, relativeFilename);
 }
 
+/*
+ * Which algorithm to compress data files with, if AH->compression asks for
+ * compression at all.  Only the dump side gets to choose; when reading, the
+ * file suffix tells cfopen_read() how each file was compressed.
+ */
+static CompressionAlgorithm
+_compressionAlgorithm(ArchiveHandle *AH)
+{
+	if (AH->public.dopt && AH->public.dopt->compress_lz4)
+		return COMPR_ALG_LZ4;
+	return COMPR_ALG_LIBZ;
+}
+
 /*
  * Prepare for parallel restore.
  *
@@ -759,9 +776,17 @@ _PrepParallelRestore(ArchiveHandle *AH)
 		else
 		{
 			/* It might be compressed */
-			strlcat(fname, ".gz", sizeof(fname));
-			if (stat(fname, &st) == 0)
+			char		cfname[MAXPGPATH];
+
+			snprintf(cfname, sizeof(cfname), "%s.gz", fname);
+			if (stat(cfname, &st) == 0)
 				te->dataLength = st.st_size;
+			else
+			{
+				snprintf(cfname, sizeof(cfname), "%s.lz4", fname);
+				if (stat(cfname, &st) == 0)
+					te->dataLength = st.st_size;
+			}
 		}
 
 		/*
@@ -41,6 +41,7 @@
 #include "access/attnum.h"
 #include "access/sysattr.h"
 #include "access/transam.h"
+#include "access/zedstore_tid.h"
 #include "catalog/pg_aggregate_d.h"
 #include "catalog/pg_am_d.h"
 #include "catalog/pg_attribute_d.h"
@@ -140,6 +141,11 @@ static int	extra_float_digits;
  */
 #define DUMP_DEFAULT_ROWS_PER_INSERT 1
 
+/*
+ * Number of TIDs in each "block" of a zedstore table's logical TID space
+ */
+#define ZEDSTORE_TIDS_PER_BLOCK (MaxZSTidOffsetNumber - 1)
+
 /*
  * Macro for producing quoted, schema-qualified name of a dumpable object.
  */
@@ -241,6 +247,7 @@ static void addBoundaryDependencies(DumpableObject **dobjs, int numObjs,
 static void getDomainConstraints(Archive *fout, TypeInfo *tyinfo);
 static void getTableData(DumpOptions *dopt, TableInfo *tblinfo, int numTables, char relkind);
 static void makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo);
+static void splitTableData(Archive *fout, TableInfo *tblinfo, int numTables);
 static void buildMatViewRefreshDependencies(Archive *fout);
 static void getTableDataFKConstraints(void);
 static char *format_function_arguments(FuncInfo *finfo, char *funcargs,
@@ -316,6 +323,7 @@ main(int argc, char **argv)
 	const char *dumpsnapshot = NULL;
 	char	   *use_role = NULL;
 	long		rowsPerInsert;
+	long		tableChunkPages;
 	int			numWorkers = 1;
 	trivalue	prompt_password = TRI_DEFAULT;
 	int			compressLevel = -1;
@@ -388,6 +396,8 @@ main(int argc, char **argv)
 		{"no-sync", no_argument, NULL, 7},
 		{"on-conflict-do-nothing", no_argument, &dopt.do_nothing, 1},
 		{"rows-per-insert", required_argument, NULL, 10},
+		{"compression-method", required_argument, NULL, 11},
+		{"table-chunk-pages", required_argument, NULL, 12},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -604,6 +614,33 @@ main(int argc, char **argv)
 				dopt.dump_inserts = (int) rowsPerInsert;
 				break;
 
+			case 11:			/* compression method */
+				if (pg_strcasecmp(optarg, "gzip") == 0)
+					dopt.compress_lz4 = false;
+				else if (pg_strcasecmp(optarg, "lz4") == 0)
+					dopt.compress_lz4 = true;
+				else
+				{
+					pg_log_error("invalid compression method \"%s\"", optarg);
+					exit_nicely(1);
+				}
+				break;
+
+			case 12:			/* table chunk pages */
+				errno = 0;
+				tableChunkPages = strtol(optarg, &endptr, 10);
+
+				if (endptr == optarg || *endptr != '\0' ||
+					tableChunkPages <= 0 || tableChunkPages > INT_MAX ||
+					errno == ERANGE)
+				{
+					pg_log_error("table-chunk-pages must be in range %d..%d",
+								 1, INT_MAX);
+					exit_nicely(1);
+				}
+				dopt.table_chunk_pages = (int) tableChunkPages;
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -668,6 +705,16 @@ main(int argc, char **argv)
 	if (archiveFormat == archNull)
 		plainText = 1;
 
+	/* LZ4 is only implemented for the per-file compression of the directory format */
+	if (dopt.compress_lz4)
+	{
+		if (archiveFormat != archDirectory)
+			fatal("compression method lz4 is only supported by the directory format");
+#ifndef USE_LZ4
+		fatal("compression method lz4 not available in this installation");
+#endif
+	}
+
 	/* Custom and directory formats are compressed by default, others not */
 	if (compressLevel == -1)
 	{
@@ -676,13 +723,18 @@ main(int argc, char **argv)
 			compressLevel = Z_DEFAULT_COMPRESSION;
 		else
 #endif
+		if (dopt.compress_lz4)
+			compressLevel = Z_DEFAULT_COMPRESSION;
+		else
 			compressLevel = 0;
 	}
 
 #ifndef HAVE_LIBZ
-	if (compressLevel != 0)
+	if (compressLevel != 0 && !dopt.compress_lz4)
+	{
 		pg_log_warning("requested compression not available in this installation -- archive will be uncompressed");
-	compressLevel = 0;
+		compressLevel = 0;
+	}
 #endif
 
 	/*
@@ -838,6 +890,8 @@ main(int argc, char **argv)
 	if (!dopt.schemaOnly)
 	{
 		getTableData(&dopt, tblinfo, numTables, 0);
+		if (dopt.table_chunk_pages > 0)
+			splitTableData(fout, tblinfo, numTables);
 		buildMatViewRefreshDependencies(fout);
 		if (dopt.dataOnly)
 			getTableDataFKConstraints();
@@ -986,6 +1040,8 @@ help(const char *progname)
 	printf(_("  -v, --verbose                verbose mode\n"));
 	printf(_("  -V, --version                output version information, then exit\n"));
 	printf(_("  -Z, --compress=0-9           compression level for compressed formats\n"));
+	printf(_("  --compression-method=METHOD  compress data files with gzip or lz4 (directory\n"
+			 "                               format only)\n"));
 	printf(_("  --lock-wait-timeout=TIMEOUT  fail after waiting TIMEOUT for a table lock\n"));
 	printf(_("  --no-sync                    do not wait for changes to be written safely to disk\n"));
 	printf(_("  -?, --help                   show this help, then exit\n"));
@@ -1032,6 +1088,9 @@ help(const char *progname)
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --table-chunk-pages=NPAGES   dump data of larger tables in chunks of NPAGES\n"
+			 "                               pages, which parallel jobs can process\n"
+			 "                               concurrently\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -1821,7 +1880,7 @@ dumpTableData_copy(Archive *fout, void *dcontext)
 		}
 		else
 			appendPQExpBufferStr(q, "* ");
-		appendPQExpBuffer(q, "FROM %s %s) TO stdout;",
+		appendPQExpBuffer(q, "FROM ONLY %s %s) TO stdout;",
 						  fmtQualifiedDumpable(tbinfo),
 						  tdinfo->filtercond);
 	}
@@ -2252,11 +2311,12 @@ dumpTableData(Archive *fout, TableDataInfo *tdinfo)
 		 * and want to order dump jobs by table size.  We choose to measure
 		 * dataLength in table pages during dump, so no scaling is needed.
 		 * However, relpages is declared as "integer" in pg_class, and hence
-		 * also in TableInfo, but it's really BlockNumber a/k/a unsigned int.
-		 * Cast so that we get the right interpretation of table sizes
-		 * exceeding INT_MAX pages.
+		 * also in TableInfo and TableDataInfo, but it's really BlockNumber
+		 * a/k/a unsigned int.  Cast so that we get the right interpretation
+		 * of table sizes exceeding INT_MAX pages.  If the table was split
+		 * into chunks, this is the size of one chunk.
 		 */
-		te->dataLength = (BlockNumber) tbinfo->relpages;
+		te->dataLength = (BlockNumber) tdinfo->datapages;
 	}
 
 	destroyPQExpBuffer(copyBuf);
@@ -2377,11 +2437,111 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	tdinfo->dobj.namespace = tbinfo->dobj.namespace;
 	tdinfo->tdtable = tbinfo;
 	tdinfo->filtercond = NULL;	/* might get set later */
+	tdinfo->datapages = tbinfo->relpages;
+	tdinfo->nextChunk = NULL;
 	addObjectDependency(&tdinfo->dobj, tbinfo->dobj.dumpId);
 
 	tbinfo->dataObj = tdinfo;
 }
 
+/*
+ * splitTableData -
+ *	  split the data of large tables into chunks of --table-chunk-pages pages
+ *
+ * Each chunk becomes a TABLE DATA item of its own, restricted to a range of
+ * ctids by its filtercond.  In a parallel dump, the chunks of a big table
+ * can then be dumped by different workers, and reloaded concurrently by a
+ * parallel pg_restore.  All workers use the same synchronized snapshot, so
+ * together the chunks still form a consistent copy of the table.  (Each
+ * chunk is read with a sequential scan, but the synchronized scan logic
+ * lets concurrent workers share most of the I/O.)
+ *
+ * The first chunk stays in tbinfo->dataObj, and the rest are chained to it
+ * through nextChunk.  The last chunk has no upper bound, so that rows
+ * beyond the estimated size of the table are not missed.
+ */
+static void
+splitTableData(Archive *fout, TableInfo *tblinfo, int numTables)
+{
+	BlockNumber chunkpages = (BlockNumber) fout->dopt->table_chunk_pages;
+	int			i;
+
+	/* comparison operators for tid appeared in 8.3 */
+	if (fout->remoteVersion < 80300)
+	{
+		pg_log_warning("server version does not support dumping tables in chunks");
+		return;
+	}
+
+	for (i = 0; i < numTables; i++)
+	{
+		TableInfo  *tbinfo = &tblinfo[i];
+		TableDataInfo *tdinfo = tbinfo->dataObj;
+		TableDataInfo *prev;
+		BlockNumber nblocks;
+		BlockNumber startblk;
+		int			nchunks;
+
+		/* Only plain table data without a filter of its own can be split */
+		if (tdinfo == NULL ||
+			tdinfo->dobj.objType != DO_TABLE_DATA ||
+			tdinfo->filtercond != NULL)
+			continue;
+
+		/*
+		 * zedstore TIDs are logical row identifiers, with each "block"
+		 * holding ZEDSTORE_TIDS_PER_BLOCK consecutive TIDs no matter how the
+		 * rows are laid out on disk, so estimate the extent of the TID space
+		 * from the row count instead of the physical size.
+		 */
+		if (tbinfo->amname && strcmp(tbinfo->amname, "zedstore") == 0)
+			nblocks = (BlockNumber) Min(tbinfo->reltuples / ZEDSTORE_TIDS_PER_BLOCK + 1,
+										(double) MaxBlockNumber);
+		else
+			nblocks = (BlockNumber) tbinfo->relpages;
+
+		if (nblocks <= chunkpages)
+			continue;
+
+		nchunks = (nblocks + chunkpages - 1) / chunkpages;
+
+		tdinfo->filtercond = psprintf("WHERE ctid < '(%u,0)'::pg_catalog.tid",
+									  chunkpages);
+		tdinfo->datapages = (int) ((BlockNumber) tbinfo->relpages / nchunks);
+
+		prev = tdinfo;
+		for (startblk = chunkpages; startblk < nblocks; startblk += chunkpages)
+		{
+			TableDataInfo *chunk;
+			int			j;
+
+			chunk = (TableDataInfo *) pg_malloc(sizeof(TableDataInfo));
+			chunk->dobj.objType = DO_TABLE_DATA;
+			chunk->dobj.catId = tdinfo->dobj.catId;
+			AssignDumpId(&chunk->dobj);
+			chunk->dobj.name = tdinfo->dobj.name;
+			chunk->dobj.namespace = tdinfo->dobj.namespace;
+			chunk->dobj.dump = tdinfo->dobj.dump;
+			chunk->tdtable = tbinfo;
+			if (nblocks - startblk > chunkpages)
+				chunk->filtercond =
+					psprintf("WHERE ctid >= '(%u,0)'::pg_catalog.tid AND ctid < '(%u,0)'::pg_catalog.tid",
+							 startblk, startblk + chunkpages);
+			else
+				chunk->filtercond =
+					psprintf("WHERE ctid >= '(%u,0)'::pg_catalog.tid",
+							 startblk);
+			chunk->datapages = tdinfo->datapages;
+			chunk->nextChunk = NULL;
+			for (j = 0; j < tdinfo->dobj.nDeps; j++)
+				addObjectDependency(&chunk->dobj, tdinfo->dobj.dependencies[j]);
+
+			prev->nextChunk = chunk;
+			prev = chunk;
+		}
+	}
+}
+
 /*
  * The refresh for a materialized view must be dependent on the refresh for
  * any materialized view that this one is dependent on.
@@ -2519,6 +2679,8 @@ getTableDataFKConstraints(void)
 		{
 			ConstraintInfo *cinfo = (ConstraintInfo *) dobjs[i];
 			TableInfo  *ftable;
+			TableDataInfo *contd;
+			TableDataInfo *reftd;
 
 			/* Not interesting unless both tables are to be dumped */
 			if (cinfo->contable == NULL ||
@@ -2531,10 +2693,14 @@ getTableDataFKConstraints(void)
 
 			/*
 			 * Okay, make referencing table's TABLE_DATA object depend on the
-			 * referenced table's TABLE_DATA object.
+			 * referenced table's TABLE_DATA object.  If either table's data
+			 * was split into chunks, every chunk is involved.
 			 */
-			addObjectDependency(&cinfo->contable->dataObj->dobj,
-								ftable->dataObj->dobj.dumpId);
+			for (contd = cinfo->contable->dataObj; contd; contd = contd->nextChunk)
+			{
+				for (reftd = ftable->dataObj; reftd; reftd = reftd->nextChunk)
+					addObjectDependency(&contd->dobj, reftd->dobj.dumpId);
+			}
 		}
 	}
 	free(dobjs);
@@ -5933,6 +6099,7 @@ getTables(Archive *fout, int *numTables)
 	int			i_toastreloptions;
 	int			i_reloftype;
 	int			i_relpages;
+	int			i_reltuples;
 	int			i_is_identity_sequence;
 	int			i_changed_acl;
 	int			i_partkeydef;
@@ -6028,7 +6195,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "tc.relminmxid AS tminmxid, "
 						  "c.relpersistence, c.relispopulated, "
-						  "c.relreplident, c.relpages, am.amname, "
+						  "c.relreplident, c.relpages, c.reltuples, am.amname, "
 						  "CASE WHEN c.reloftype <> 0 THEN c.reloftype::pg_catalog.regtype ELSE NULL END AS reloftype, "
 						  "d.refobjid AS owning_tab, "
 						  "d.refobjsubid AS owning_col, "
@@ -6117,7 +6284,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "tc.relminmxid AS tminmxid, "
 						  "c.relpersistence, c.relispopulated, "
-						  "c.relreplident, c.relpages, "
+						  "c.relreplident, c.relpages, c.reltuples, "
 						  "NULL AS amname, "
 						  "CASE WHEN c.reloftype <> 0 THEN c.reloftype::pg_catalog.regtype ELSE NULL END AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6167,7 +6334,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "tc.relminmxid AS tminmxid, "
 						  "c.relpersistence, c.relispopulated, "
-						  "c.relreplident, c.relpages, "
+						  "c.relreplident, c.relpages, c.reltuples, "
 						  "NULL AS amname, "
 						  "CASE WHEN c.reloftype <> 0 THEN c.reloftype::pg_catalog.regtype ELSE NULL END AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6217,7 +6384,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "tc.relminmxid AS tminmxid, "
 						  "c.relpersistence, c.relispopulated, "
-						  "'d' AS relreplident, c.relpages, "
+						  "'d' AS relreplident, c.relpages, c.reltuples, "
 						  "NULL AS amname, "
 						  "CASE WHEN c.reloftype <> 0 THEN c.reloftype::pg_catalog.regtype ELSE NULL END AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6267,7 +6434,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "0 AS tminmxid, "
 						  "c.relpersistence, 't' as relispopulated, "
-						  "'d' AS relreplident, c.relpages, "
+						  "'d' AS relreplident, c.relpages, c.reltuples, "
 						  "NULL AS amname, "
 						  "CASE WHEN c.reloftype <> 0 THEN c.reloftype::pg_catalog.regtype ELSE NULL END AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6315,7 +6482,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "0 AS tminmxid, "
 						  "'p' AS relpersistence, 't' as relispopulated, "
-						  "'d' AS relreplident, c.relpages, "
+						  "'d' AS relreplident, c.relpages, c.reltuples, "
 						  "NULL AS amname, "
 						  "CASE WHEN c.reloftype <> 0 THEN c.reloftype::pg_catalog.regtype ELSE NULL END AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6362,7 +6529,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "0 AS tminmxid, "
 						  "'p' AS relpersistence, 't' as relispopulated, "
-						  "'d' AS relreplident, c.relpages, "
+						  "'d' AS relreplident, c.relpages, c.reltuples, "
 						  "NULL AS amname, "
 						  "NULL AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6409,7 +6576,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.relfrozenxid AS tfrozenxid, "
 						  "0 AS tminmxid, "
 						  "'p' AS relpersistence, 't' as relispopulated, "
-						  "'d' AS relreplident, c.relpages, "
+						  "'d' AS relreplident, c.relpages, c.reltuples, "
 						  "NULL AS amname, "
 						  "NULL AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6455,7 +6622,7 @@ getTables(Archive *fout, int *numTables)
 						  "0 AS toid, "
 						  "0 AS tfrozenxid, 0 AS tminmxid,"
 						  "'p' AS relpersistence, 't' as relispopulated, "
-						  "'d' AS relreplident, relpages, "
+						  "'d' AS relreplident, relpages, reltuples, "
 						  "NULL AS amname, "
 						  "NULL AS reloftype, "
 						  "d.refobjid AS owning_tab, "
@@ -6524,6 +6691,7 @@ getTables(Archive *fout, int *numTables)
 	i_relispopulated = PQfnumber(res, "relispopulated");
 	i_relreplident = PQfnumber(res, "relreplident");
 	i_relpages = PQfnumber(res, "relpages");
+	i_reltuples = PQfnumber(res, "reltuples");
 	i_owning_tab = PQfnumber(res, "owning_tab");
 	i_owning_col = PQfnumber(res, "owning_col");
 	i_reltablespace = PQfnumber(res, "reltablespace");
@@ -6579,6 +6747,7 @@ getTables(Archive *fout, int *numTables)
 		tblinfo[i].relispopulated = (strcmp(PQgetvalue(res, i, i_relispopulated), "t") == 0);
 		tblinfo[i].relreplident = *(PQgetvalue(res, i, i_relreplident));
 		tblinfo[i].relpages = atoi(PQgetvalue(res, i, i_relpages));
+		tblinfo[i].reltuples = strtod(PQgetvalue(res, i, i_reltuples), NULL);
 		tblinfo[i].frozenxid = atooid(PQgetvalue(res, i, i_relfrozenxid));
 		tblinfo[i].minmxid = atooid(PQgetvalue(res, i, i_relminmxid));
 		tblinfo[i].toast_oid = atooid(PQgetvalue(res, i, i_toastoid));
@@ -287,6 +287,7 @@ typedef struct _tableInfo
 	int			owning_col;		/* attr # of column owning sequence */
 	bool		is_identity_sequence;
 	int			relpages;		/* table's size in pages (from pg_class) */
+	double		reltuples;		/* estimated row count (from pg_class) */
 
 	bool		interesting;	/* true if need to collect more data */
 	bool		dummy_view;		/* view's real definition must be postponed */
@@ -349,6 +350,8 @@ typedef struct _tableDataInfo
 	DumpableObject dobj;
 	TableInfo  *tdtable;		/* link to table to dump */
 	char	   *filtercond;		/* WHERE condition to limit rows dumped */
+	int			datapages;		/* size of this item in pages, like relpages */
+	struct _tableDataInfo *nextChunk;	/* next ctid-range chunk, or NULL */
 } TableDataInfo;
 
 typedef struct _indxInfo
@@ -4,7 +4,7 @@ use warnings;
 use Config;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 74;
+use Test::More tests => 80;
 
 my $tempdir       = TestLib::tempdir;
 my $tempdir_short = TestLib::tempdir_short;
@@ -127,6 +127,21 @@ command_fails_like(
 	'pg_dump: --on-conflict-do-nothing requires --inserts, --rows-per-insert, --column-inserts'
 );
 
+command_fails_like(
+	[ 'pg_dump', '--table-chunk-pages', '0' ],
+	qr/\Qpg_dump: error: table-chunk-pages must be in range 1..2147483647\E/,
+	'pg_dump: table-chunk-pages must be in range 1..2147483647');
+
+command_fails_like(
+	[ 'pg_dump', '--compression-method', 'bzip2' ],
+	qr/\Qpg_dump: error: invalid compression method "bzip2"\E/,
+	'pg_dump: invalid compression method');
+
+command_fails_like(
+	[ 'pg_dump', '-Fc', '--compression-method', 'lz4' ],
+	qr/\Qpg_dump: error: compression method lz4 is only supported by the directory format\E/,
+	'pg_dump: compression method lz4 requires directory format');
+
 # pg_dumpall command-line argument checks
 command_fails_like(
 	[ 'pg_dumpall', '-g', '-r' ],
@@ -0,0 +1,100 @@
+# Test dumping the data of large tables in chunks, with --table-chunk-pages,
+# and restoring such a dump with parallel jobs.
+
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 12;
+
+my $tempdir = TestLib::tempdir;
+
+my $node = get_new_node('main');
+$node->init;
+$node->start;
+
+$node->safe_psql('postgres', 'CREATE DATABASE chunked_src');
+$node->safe_psql('postgres', 'CREATE DATABASE chunked_dst');
+
+# A heap table spanning a couple of dozen pages, and a zedstore table whose
+# chunks are derived from its row count.  The primary keys make a restore
+# fail if a row ends up in two chunks, and must not be built before all the
+# chunks have been loaded.
+$node->safe_psql(
+	'chunked_src', q{
+	CREATE TABLE heap_chunked (id int PRIMARY KEY, t text);
+	INSERT INTO heap_chunked SELECT g, md5(g::text) FROM generate_series(1, 2000) g;
+	CREATE TABLE zs_chunked (id int PRIMARY KEY, t text) USING zedstore;
+	INSERT INTO zs_chunked SELECT g, md5(g::text) FROM generate_series(1, 5000) g;
+	DELETE FROM heap_chunked WHERE id % 7 = 0;
+	VACUUM ANALYZE heap_chunked;
+	VACUUM ANALYZE zs_chunked;
+});
+
+my $dumpdir = "$tempdir/chunked_dump";
+
+command_ok(
+	[
+		'pg_dump', '-Fd', '-j2', '--table-chunk-pages=2',
+		'-f', $dumpdir, '-d', $node->connstr('chunked_src')
+	],
+	'pg_dump: parallel dump with --table-chunk-pages');
+
+my ($stdout, $stderr);
+IPC::Run::run [ 'pg_restore', '-l', $dumpdir ], '>', \$stdout, '2>',
+  \$stderr;
+
+like($stdout, qr/^;\s+Dump Version: 1\.15-0$/m, 'archive has version 1.15');
+
+my @heap_chunks = ($stdout =~ /TABLE DATA public heap_chunked /g);
+my @zs_chunks   = ($stdout =~ /TABLE DATA public zs_chunked /g);
+cmp_ok(scalar(@heap_chunks), '>', 1, 'heap table dumped in several chunks');
+cmp_ok(scalar(@zs_chunks), '>', 1, 'zedstore table dumped in several chunks');
+
+command_ok(
+	[
+		'pg_restore', '-j2', '-d', $node->connstr('chunked_dst'),
+		$dumpdir
+	],
+	'pg_restore: parallel restore of chunked dump');
+
+# Compare the restored contents with the original
+foreach my $table ('heap_chunked', 'zs_chunked')
+{
+	my $query =
+	  "SELECT count(*), md5(string_agg(id || ':' || t, ',' ORDER BY id)) FROM $table";
+	my $src = $node->safe_psql('chunked_src', $query);
+	my $dst = $node->safe_psql('chunked_dst', $query);
+
+	is($dst, $src, "$table: restored contents match");
+}
+
+is( $node->safe_psql(
+		'chunked_dst',
+		"SELECT count(*) FROM pg_index WHERE indisvalid AND indrelid IN ('heap_chunked'::regclass, 'zs_chunked'::regclass)"
+	),
+	'2',
+	'primary keys restored');
+
+is( $node->safe_psql(
+		'chunked_dst',
+		"SELECT amname FROM pg_class c JOIN pg_am a ON a.oid = c.relam WHERE relname = 'zs_chunked'"
+	),
+	'zedstore',
+	'zedstore table restored with its access method');
+
+# The same archive, restored serially into a fresh database
+$node->safe_psql('postgres', 'CREATE DATABASE chunked_dst2');
+command_ok(
+	[ 'pg_restore', '-d', $node->connstr('chunked_dst2'), $dumpdir ],
+	'pg_restore: serial restore of chunked dump');
+
+is( $node->safe_psql(
+		'chunked_dst2', 'SELECT count(*) FROM heap_chunked'),
+	'1715',
+	'heap_chunked: serial restore has all rows');
+is($node->safe_psql('chunked_dst2', 'SELECT count(*) FROM zs_chunked'),
+	'5000', 'zs_chunked: serial restore has all rows');
+
+$node->stop;
@@ -712,6 +712,10 @@ typedef struct ZSAttrTreeScan
  * a smgr invalidation happens. Logically, the lifetime of this is the same
  * as smgr_targblocks/smgr_fsm_nblocks/smgr_vm_nblocks, but there's no way
  * to attach an AM-specific struct directly to SmgrRelation.
+ *
+ * When the backend-private copy is rebuilt, it is normally copied from a
+ * shared-memory cache of the same information (see zedstore_meta.c), so that
+ * each backend doesn't need to read the metapage.
  */
 typedef struct ZSMetaCacheData
 {
@@ -727,6 +731,10 @@ typedef struct ZSMetaCacheData
 } ZSMetaCacheData;
 
 extern ZSMetaCacheData *zsmeta_populate_cache(Relation rel);
+extern void zsmeta_invalidate_shared_cache(Relation rel);
+extern void zsmeta_forget_shared_cache(const RelFileNode *rnode);
+extern void zsmeta_update_shared_rightmost(Relation rel, AttrNumber attno,
+										   BlockNumber rightmost, zstid rightmost_lokey);
 
 static inline ZSMetaCacheData *
 zsmeta_get_cache(Relation rel)
@@ -907,6 +915,7 @@ extern void zsbt_attr_end_scan(ZSAttrTreeScan *scan);
 extern bool zsbt_attr_scan_fetch_array(ZSAttrTreeScan *scan, zstid tid);
 
 extern void zsbt_attr_add(Relation rel, AttrNumber attno, attstream_buffer *newstream);
+extern bool zsbt_attr_recompress_page(Form_pg_attribute attr, Page page);
 extern void zsbt_attstream_change_redo(XLogReaderState *record);
 
 /* prototypes for functions in zedstore_attstream.c */
@@ -974,6 +983,22 @@ zsbt_attr_fetch(ZSAttrTreeScan *scan, Datum *datum, bool *isnull, zstid tid)
 {
 	int			idx;
 
+	/*
+	 * Fast path for a forward scan that visits every row: the item we're
+	 * looking for is the one right after the previous one.  This avoids the
+	 * range checks and the search loop below for almost all rows.
+	 */
+	idx = scan->decoder_last_idx + 1;
+	if (scan->decoder_last_idx != -1 &&
+		idx < scan->decoder.num_elements &&
+		scan->decoder.tids[idx] == tid)
+	{
+		*isnull = scan->decoder.isnulls[idx];
+		*datum = scan->decoder.datums[idx];
+		scan->decoder_last_idx = idx;
+		return true;
+	}
+
 	/*
 	 * Fetch the next item from the scan. The item we're looking for might
 	 * already be in scan->array_*.
@@ -115,7 +115,8 @@ typedef struct
 typedef struct
 {
 	ZSUndoRec	rec;
-	zstid		tid;
+	zstid		tid;			/* first locked tuple; the record can be
+								 * shared by several tuples' items */
 
 	/*
 	 * XXX: Is it OK to store this on disk? The enum values could change. Then
@@ -182,6 +183,8 @@ extern zs_pending_undo_op *zsundo_create_for_update(Relation rel, TransactionId
 extern zs_pending_undo_op *zsundo_create_for_tuple_lock(Relation rel, TransactionId xid, CommandId cid,
 														zstid tid, LockTupleMode lockmode,
 														ZSUndoRecPtr prev_undo_ptr);
+extern ZSUndoRecPtr zsundo_find_reusable_tuple_lock(Relation rel, TransactionId xid,
+													LockTupleMode lockmode);
 extern void zsundo_finish_pending_op(zs_pending_undo_op *pendingop, char *payload);
 extern void zsundo_clear_speculative_token(Relation rel, ZSUndoRecPtr undoptr);
 
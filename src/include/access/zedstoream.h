@@ -14,4 +14,7 @@ extern void AtEOXact_zedstore_tuplebuffers(bool isCommit);
 extern void AtSubStart_zedstore_tuplebuffers(void);
 extern void AtEOSubXact_zedstore_tuplebuffers(bool isCommit);
 
+extern Size ZSMetaCacheShmemSize(void);
+extern void ZSMetaCacheShmemInit(void);
+
 #endif							/* ZEDSTOREAM_H */
@@ -296,6 +296,7 @@ extern PGDLLIMPORT int DeadlockTimeout;
 extern int	StatementTimeout;
 extern int	LockTimeout;
 extern int	IdleInTransactionSessionTimeout;
+extern int	IdleSessionTimeout;
 extern bool log_lock_waits;
 
 
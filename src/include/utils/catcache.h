@@ -22,6 +22,7 @@
 
 #include "access/htup.h"
 #include "access/skey.h"
+#include "datatype/timestamp.h"
 #include "lib/ilist.h"
 #include "utils/relcache.h"
 
@@ -118,6 +119,7 @@ typedef struct catctup
 	int			refcount;		/* number of active references */
 	bool		dead;			/* dead but not yet removed? */
 	bool		negative;		/* negative cache entry? */
+	TimestampTz lastaccess;		/* catcacheclock at last use */
 	HeapTupleData tuple;		/* tuple management header */
 
 	/*
@@ -186,6 +188,21 @@ typedef struct catcacheheader
 } CatCacheHeader;
 
 
+/* GUC parameter */
+extern int	catalog_cache_prune_min_age;
+
+/*
+ * Coarse clock used to timestamp catcache entry accesses; advanced once per
+ * statement so that a cache hit costs no more than a store.
+ */
+extern PGDLLIMPORT TimestampTz catcacheclock;
+
+static inline void
+SetCatCacheClock(TimestampTz ts)
+{
+	catcacheclock = ts;
+}
+
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
 
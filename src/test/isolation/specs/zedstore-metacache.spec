@@ -0,0 +1,41 @@
+# Shared metapage cache of zedstore tables
+#
+# Readers look up the root of each attribute tree through their own cache,
+# which is filled from a cache in shared memory. When another session
+# creates an attribute tree, by inserting into a column that was added with
+# ADD COLUMN and so has no tree yet, or by giving the table a whole new
+# relfilenode, the readers must find the new tree even though their cache,
+# and the shared cache, said that it didn't exist when they last looked.
+# Session s3 only starts reading after the changes, so it gets the root
+# block numbers from the shared cache.
+
+setup
+{
+  CREATE TABLE zs_metacache (a int) USING zedstore;
+  INSERT INTO zs_metacache SELECT g FROM generate_series(1, 10) g;
+  ALTER TABLE zs_metacache ADD COLUMN b int DEFAULT 7;
+}
+
+teardown
+{
+  DROP TABLE zs_metacache;
+}
+
+session "s1"
+step "s1sel"	{ SELECT count(*), sum(a), sum(b), count(b) FROM zs_metacache; }
+step "s1rr"		{ BEGIN ISOLATION LEVEL REPEATABLE READ; }
+step "s1c"		{ COMMIT; }
+
+session "s2"
+step "s2ins"	{ INSERT INTO zs_metacache VALUES (100, 100); }
+step "s2null"	{ INSERT INTO zs_metacache VALUES (200, NULL); }
+step "s2trunc"	{ TRUNCATE zs_metacache; }
+step "s2refill"	{ INSERT INTO zs_metacache VALUES (1, 1), (2, 2); }
+
+session "s3"
+step "s3sel"	{ SELECT count(*), sum(a), sum(b), count(b) FROM zs_metacache; }
+
+permutation "s1sel" "s2ins" "s1sel" "s3sel"
+permutation "s1sel" "s2null" "s1sel" "s2ins" "s1sel" "s3sel"
+permutation "s1rr" "s1sel" "s2ins" "s1sel" "s1c" "s1sel" "s3sel"
+permutation "s1sel" "s2trunc" "s1sel" "s2refill" "s1sel" "s3sel"
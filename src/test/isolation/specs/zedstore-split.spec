@@ -0,0 +1,43 @@
+# Concurrent readers and writers on zedstore B-trees
+#
+# Readers descend the TID and attribute trees with shared locks, while the
+# writer splits leaf and internal pages by inserting, and frees them up by
+# deleting.  The readers must still see a consistent snapshot, and must see
+# all the new rows once the writer commits.
+#
+# A reader that is in the middle of a scan when the pages it was positioned
+# on are split must find its way to the right sibling, or descend again
+# from a root that has moved, so the cursor steps pause the scan near the
+# rightmost leaves while the writer splits them.
+
+setup
+{
+  CREATE TABLE zs_split (id int, t text) USING zedstore;
+  INSERT INTO zs_split SELECT g, md5(g::text) FROM generate_series(1, 1000) g;
+}
+
+teardown
+{
+  DROP TABLE zs_split;
+}
+
+session "s1"
+step "s1b"		{ BEGIN; }
+step "s1ins"	{ INSERT INTO zs_split SELECT g, md5(g::text) FROM generate_series(1001, 50000) g; }
+step "s1del"	{ DELETE FROM zs_split WHERE id % 3 = 0; }
+step "s1c"		{ COMMIT; }
+
+session "s2"
+step "s2sel"	{ SELECT count(*), min(id), max(id) FROM zs_split; }
+step "s2b"		{ BEGIN; }
+step "s2decl"	{ DECLARE c CURSOR FOR SELECT id, t = md5(id::text) AS ok FROM zs_split; }
+step "s2fetch1"	{ FETCH ABSOLUTE 990 FROM c; }
+step "s2fetch2"	{ FETCH ABSOLUTE 1000 FROM c; }
+step "s2fetch3"	{ FETCH NEXT FROM c; }
+step "s2c"		{ COMMIT; }
+
+permutation "s1b" "s1ins" "s2sel" "s1c" "s2sel"
+permutation "s1b" "s1ins" "s1del" "s2sel" "s1c" "s2sel"
+# split while a scan is paused, in the same and in a later transaction
+permutation "s2b" "s2decl" "s2fetch1" "s1ins" "s2fetch2" "s2fetch3" "s2c" "s2sel"
+permutation "s1b" "s2b" "s2decl" "s2fetch1" "s1ins" "s1del" "s2fetch2" "s1c" "s2fetch3" "s2c" "s2sel"
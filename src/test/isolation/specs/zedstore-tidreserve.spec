@@ -0,0 +1,44 @@
+# TID reservations of concurrent zedstore inserters
+#
+# A backend inserting many rows into a zedstore table reserves TIDs at the
+# end of the TID tree in growing batches.  The TIDs it doesn't use are
+# removed again when the command ends, so the TID space used by all the
+# inserters must stay within a small multiple of the rows they inserted.
+# A reservation made by a transaction that aborts must not be used by the
+# next transaction of the same backend, or by a subtransaction that follows
+# an aborted one; those rows would be invisible.
+
+setup
+{
+  CREATE TABLE zs_tidres (s int, i int) USING zedstore;
+}
+
+teardown
+{
+  DROP TABLE zs_tidres;
+}
+
+session "s1"
+step "s1b"		{ BEGIN; }
+step "s1ins1"	{ INSERT INTO zs_tidres SELECT 1, g FROM generate_series(1, 3000) g; }
+step "s1ins2"	{ INSERT INTO zs_tidres SELECT 1, g FROM generate_series(3001, 6000) g; }
+step "s1c"		{ COMMIT; }
+
+session "s2"
+step "s2b"		{ BEGIN; }
+step "s2ins1"	{ INSERT INTO zs_tidres SELECT 2, g FROM generate_series(1, 3000) g; }
+step "s2ins2"	{ INSERT INTO zs_tidres SELECT 2, g FROM generate_series(3001, 6000) g; }
+step "s2sub"	{ SAVEPOINT sp; INSERT INTO zs_tidres SELECT 2, g FROM generate_series(6001, 9000) g; ROLLBACK TO sp; }
+step "s2ins4"	{ INSERT INTO zs_tidres SELECT 2, g FROM generate_series(6001, 7000) g; }
+step "s2c"		{ COMMIT; }
+step "s2a"		{ ROLLBACK; }
+step "s2ins3"	{ INSERT INTO zs_tidres SELECT 2, g FROM generate_series(1, 1000) g; }
+
+session "s3"
+step "s3check"	{ SELECT s, count(*), count(DISTINCT i), min(i), max(i) FROM zs_tidres GROUP BY s ORDER BY s; }
+step "s3tids"	{ SELECT max(t) - min(t) + 1 <= 2 * count(*) AS tids_bounded FROM (SELECT ctid::zstid::int8 AS t FROM zs_tidres) x; }
+
+permutation "s1b" "s2b" "s1ins1" "s2ins1" "s1ins2" "s2ins2" "s1c" "s2c" "s3check" "s3tids"
+# the aborted transaction's TIDs count against the bound, too
+permutation "s1b" "s2b" "s1ins1" "s2ins1" "s2a" "s1ins2" "s1c" "s2ins3" "s3check" "s3tids"
+permutation "s2b" "s2sub" "s2ins4" "s2c" "s3check"
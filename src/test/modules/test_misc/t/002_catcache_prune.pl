@@ -0,0 +1,103 @@
+# Verify that catalog cache entries that have not been used for
+# catalog_cache_prune_min_age are pruned when a cache would be enlarged
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 7;
+
+# Initialize a test cluster
+my $node = get_new_node('master');
+$node->init();
+# Turn message level up to DEBUG1 so that we get the messages we want to see
+$node->append_conf('postgresql.conf', 'client_min_messages = DEBUG1');
+$node->start;
+
+# Run SQL commands in one session and return psql's stderr (including debug
+# messages)
+sub run_sql_command
+{
+	my $sql = shift;
+	my $stderr;
+
+	$node->psql(
+		'postgres',
+		$sql,
+		stderr        => \$stderr,
+		on_error_die  => 1,
+		on_error_stop => 1);
+	return $stderr;
+}
+
+# Total number of entries pruned from the caches on pg_class, and the number
+# of times those caches were enlarged, according to the debug messages
+sub prune_stats
+{
+	my $output = shift;
+	my $pruned = 0;
+	my $rehashed = 0;
+
+	$pruned += $1
+	  while ($output =~ m/pruned (\d+) entries from catalog cache id \d+ for pg_class/g);
+	$rehashed++
+	  while ($output =~ m/rehashed catalog cache id \d+ for pg_class/g);
+	return ($pruned, $rehashed);
+}
+
+# Each statement looks up 3000 nonexistent relation names, which leaves a
+# negative entry per name and schema in the search path in the cache.
+my $lookup_a =
+  "select count(to_regclass('catcache_prune_a' || g)) from generate_series(1, 3000) g;\n";
+my $lookup_b =
+  "select count(to_regclass('catcache_prune_b' || g)) from generate_series(1, 3000) g;\n";
+
+my ($output, $pruned, $rehashed);
+
+note "entries not used since an earlier statement are pruned";
+
+$output = run_sql_command(
+	"set catalog_cache_prune_min_age = 0;\n" . $lookup_a . $lookup_b);
+($pruned, $rehashed) = prune_stats($output);
+cmp_ok($pruned, '>=', 6000,
+	'entries of the first statement pruned by the second one');
+
+note "entries used again are kept";
+
+# The second statement looks up all the names of the first one again, before
+# adding the new ones
+$output = run_sql_command("set catalog_cache_prune_min_age = 0;\n"
+	  . $lookup_a
+	  . "select (select count(to_regclass('catcache_prune_a' || g)) from generate_series(1, 3000) g) + "
+	  . "(select count(to_regclass('catcache_prune_b' || g)) from generate_series(1, 3000) g);\n");
+($pruned, $rehashed) = prune_stats($output);
+cmp_ok($pruned, '<', 6000,
+	'entries looked up again in the second statement not pruned');
+cmp_ok($rehashed, '>', 0, 'cache enlarged to hold the entries still in use');
+
+note "entries younger than catalog_cache_prune_min_age are kept";
+
+$output = run_sql_command(
+	"set catalog_cache_prune_min_age = '1h';\n" . $lookup_a . $lookup_b);
+($pruned, $rehashed) = prune_stats($output);
+is($pruned, 0, 'no entries pruned before they are old enough');
+cmp_ok($rehashed, '>', 0, 'cache enlarged instead');
+
+note "pruning can be disabled";
+
+$output = run_sql_command(
+	"set catalog_cache_prune_min_age = -1;\n" . $lookup_a . $lookup_b);
+ok($output !~ m/pruned \d+ entries from catalog cache/,
+	'no pruning attempted when disabled');
+
+# The caches still work after pruning
+is( $node->safe_psql(
+		'postgres', "set catalog_cache_prune_min_age = 0;\n"
+		  . "create table catcache_prune_a1 (a int);\n"
+		  . $lookup_a
+		  . $lookup_b
+		  . "select to_regclass('catcache_prune_a1');"),
+	"1\n0\ncatcache_prune_a1",
+	'lookups correct after pruning');
+
+$node->stop;
@@ -845,3 +845,37 @@ explain (costs off) select * from range_parted order by a,b,c;
 explain (costs off) select * from range_parted order by a desc,b desc,c desc;
 
 drop table range_parted;
+
+--
+-- Inherited UPDATE/DELETE plan a separate copy of the query for each target
+-- relation, sharing plain relation RTEs between them.  Check that RTEs that
+-- need translating for each child, and the parent's securityQuals, are not
+-- shared.
+--
+create table inhshare (a int, b text);
+create table inhshare_c1 () inherits (inhshare);
+create table inhshare_c2 () inherits (inhshare);
+insert into inhshare values (1, 'p');
+insert into inhshare_c1 values (2, 'c1');
+insert into inhshare_c2 values (3, 'c2');
+-- self-join through the inheritance tree, and a subquery referencing it
+update inhshare t set b = t.b || '-' || s.b
+  from inhshare s, (select max(a) as m from inhshare) ss
+  where s.a = ss.m + 1 - t.a;
+select tableoid::regclass, * from inhshare order by a;
+delete from inhshare t
+  using (select a from inhshare where b like 'c%') ss
+  where t.a = ss.a + 1;
+select tableoid::regclass, * from inhshare order by a;
+-- the parent's policy must apply to each child exactly once
+alter table inhshare enable row level security;
+create policy inhshare_pol on inhshare using (a <> 2);
+create role regress_inhshare_user;
+grant all on inhshare to regress_inhshare_user;
+insert into inhshare_c2 values (4, 'c2');
+set role regress_inhshare_user;
+update inhshare set b = b || '+' returning tableoid::regclass, a, b;
+reset role;
+select tableoid::regclass, * from inhshare order by a;
+drop table inhshare cascade;
+drop role regress_inhshare_user;
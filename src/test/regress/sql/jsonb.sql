@@ -1260,3 +1260,16 @@ select '12345.0000000000000000000000000000000000000000000005'::jsonb::float8;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int2;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int4;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int8;
+
+-- field extraction from documents stored out of line
+create temp table jsonb_toasted (id int, doc jsonb);
+alter table jsonb_toasted alter column doc set storage external;
+insert into jsonb_toasted
+  select i, jsonb_build_object('id', i, 'pad', repeat('x', 3000),
+                               'arr', jsonb_build_array(i, i * 2))
+  from generate_series(1, 3) i;
+select id, doc->'id' as f, doc->>'id' as t, doc->'arr'->1 as a1,
+       doc #>> '{arr,0}' as a0, length(doc->>'pad') as padlen,
+       doc #> '{}' = doc as same
+  from jsonb_toasted order by id;
+drop table jsonb_toasted;
@@ -642,6 +642,23 @@ SELECT AVG(val) FROM num_data;
 SELECT STDDEV(val) FROM num_data;
 SELECT VARIANCE(val) FROM num_data;
 
+-- SUM and AVG over inputs that fit in a scaled 64-bit integer, mixed with
+-- ones that don't because of their magnitude or scale
+SELECT sum(v), avg(v) FROM (VALUES (1.5), (2.25), (-0.125), (0.00)) t(v);
+
+SELECT sum(v) FROM (VALUES (1.50), (-1.50)) t(v);
+
+SELECT sum(v)
+  FROM (VALUES (12345678901234567.89), (98765432109876543210.5),
+               (0.0000000000000000000001), (-1)) t(v);
+
+SELECT sum(v)
+  FROM (VALUES (9223372036854775807), (9223372036854775807),
+               (-9223372036854775808)) t(v);
+
+SELECT i, sum(v) OVER (ORDER BY i ROWS BETWEEN 1 PRECEDING AND CURRENT ROW)
+  FROM (VALUES (1, 1.5), (2, 2.25), (3, 99999999999999999999.1), (4, 3)) t(i, v);
+
 -- Check for appropriate rounding and overflow
 CREATE TABLE fract_only (id int, val numeric(4,4));
 INSERT INTO fract_only VALUES (1, '0.0');
@@ -193,6 +193,20 @@ create table bmscantest (a int, t text);
 insert into bmscantest select r, 'fooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooo' FROM generate_series(1,100000) r;
 create index i_bmtest ON bmscantest(a);
 select count(*) from bmscantest where a>1;
+-- pages are handed out to the workers in ranges of block numbers; check
+-- that every row is returned exactly once, with lossy pages and with gaps
+-- in the bitmap
+explain (costs off)
+	select count(*), sum(unique1) from tenk1 where hundred > 1;
+select count(*), sum(unique1) from tenk1 where hundred > 1;
+select count(*), sum(a) from bmscantest
+  where a < 5000 or a between 30000 and 30100 or a > 99000;
+create table bmscantest_zs (a int, t text) using zedstore;
+insert into bmscantest_zs select r, 'fooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooo' FROM generate_series(1,100000) r;
+create index i_bmtest_zs ON bmscantest_zs(a);
+select count(*), sum(a) from bmscantest_zs
+  where a < 5000 or a between 30000 and 30100 or a > 99000;
+drop table bmscantest_zs;
 
 -- test accumulation of stats for parallel nodes
 reset enable_seqscan;
@@ -257,3 +257,38 @@ RESET ROLE;
 DROP TABLE vacowned;
 DROP TABLE vacowned_parted;
 DROP ROLE regress_vacuum;
+
+-- The shared relation size cache must follow extension, truncation and
+-- removal of relation files.  relpages is computed from the cached size,
+-- while pg_relation_size() always looks at the files.
+CREATE TABLE relsize_cache (a int, b text) WITH (autovacuum_enabled = off);
+ANALYZE relsize_cache;
+INSERT INTO relsize_cache SELECT g, repeat('x', 100) FROM generate_series(1, 1000) g;
+ANALYZE relsize_cache;
+SELECT relpages > 1 AS extended,
+       relpages = pg_relation_size(oid) / current_setting('block_size')::int AS size_ok
+  FROM pg_class WHERE relname = 'relsize_cache';
+-- truncated in place, since it was created in the same transaction
+BEGIN;
+CREATE TABLE relsize_cache2 (a int, b text) WITH (autovacuum_enabled = off);
+INSERT INTO relsize_cache2 SELECT g, repeat('x', 100) FROM generate_series(1, 1000) g;
+ANALYZE relsize_cache2;
+TRUNCATE relsize_cache2;
+INSERT INTO relsize_cache2 SELECT g, repeat('x', 100) FROM generate_series(1, 10) g;
+ANALYZE relsize_cache2;
+COMMIT;
+SELECT relpages,
+       relpages = pg_relation_size(oid) / current_setting('block_size')::int AS size_ok
+  FROM pg_class WHERE relname = 'relsize_cache2';
+-- the new file is removed at rollback, the old one is used again
+BEGIN;
+TRUNCATE relsize_cache;
+INSERT INTO relsize_cache SELECT g, repeat('x', 100) FROM generate_series(1, 10) g;
+ANALYZE relsize_cache;
+ROLLBACK;
+ANALYZE relsize_cache;
+SELECT relpages > 1 AS extended,
+       relpages = pg_relation_size(oid) / current_setting('block_size')::int AS size_ok
+  FROM pg_class WHERE relname = 'relsize_cache';
+DROP TABLE relsize_cache;
+DROP TABLE relsize_cache2;
@@ -1258,6 +1258,20 @@ SELECT i, b, bool_and(b) OVER w, bool_or(b) OVER w
   FROM (VALUES (1,true), (2,true), (3,false), (4,false), (5,true)) v(i,b)
   WINDOW w AS (ORDER BY i ROWS BETWEEN CURRENT ROW AND 1 FOLLOWING);
 
+-- test sliding-window evaluation of aggregates that have a combine function
+-- but no inverse transition function, alongside ones that must restart
+SELECT p, i, v, max(v) OVER w, min(v) OVER w,
+       max(i) FILTER (WHERE v IS NOT NULL) OVER w AS last_i,
+       sum(i::float8) OVER w, string_agg(v, ',') OVER w
+  FROM (VALUES (1,1,'d'), (1,2,'a'), (1,3,NULL), (1,4,'f'), (1,5,'b'),
+               (1,6,'e'), (1,7,'c'), (2,1,'x'), (2,2,NULL), (2,3,'y')) t(p,i,v)
+  WINDOW w AS (PARTITION BY p ORDER BY i ROWS BETWEEN 2 PRECEDING AND 1 FOLLOWING);
+
+SELECT p, i, max(v) OVER w, min(v) OVER w
+  FROM (VALUES (1,1,'d'), (1,2,'a'), (1,3,NULL), (1,4,'f'), (1,5,'b'),
+               (1,6,'e'), (1,7,'c'), (2,1,'x'), (2,2,NULL), (2,3,'y')) t(p,i,v)
+  WINDOW w AS (PARTITION BY p ORDER BY i ROWS BETWEEN 1 FOLLOWING AND 3 FOLLOWING);
+
 -- Tests for problems with failure to walk or mutate expressions
 -- within window frame clauses.
 
@@ -159,6 +159,29 @@ COPY t_zedcopy (b, d) from stdin;
 rollback;
 select count(*) from t_zedcopy where b >= 20000;
 
+-- COPY FREEZE into a table created in the same transaction doesn't
+-- create UNDO records
+begin;
+create table t_zedcopyfreeze(a int, b text) using zedstore;
+COPY t_zedcopyfreeze from stdin (freeze);
+1	one
+2	two
+3	three
+\.
+commit;
+select * from t_zedcopyfreeze;
+select count(*) from pg_zs_undo_pages('t_zedcopyfreeze') where nrecords > 0;
+delete from t_zedcopyfreeze where a = 2;
+select * from t_zedcopyfreeze;
+
+begin;
+truncate t_zedcopyfreeze;
+COPY t_zedcopyfreeze from stdin (freeze);
+4	four
+\.
+rollback;
+select * from t_zedcopyfreeze;
+
 --
 -- Test zero column table
 --
@@ -205,7 +228,47 @@ INSERT INTO t_ztablesample
        SELECT i, repeat(i::text, 2) FROM generate_series(0, 299) s(i);
 -- lets delete half (even numbered ids) rows to limit the output
 DELETE FROM t_ztablesample WHERE id%2 = 0;
--- should return ALL visible tuples from SOME blocks
-SELECT ctid,t.id FROM t_ztablesample AS t TABLESAMPLE SYSTEM (50) REPEATABLE (0);
+-- should return ALL visible tuples from SOME blocks. A sampling unit
+-- spans several logical blocks, depending on the physical size of the
+-- table, so check that every sampled logical block is complete, rather
+-- than which ones were picked.
+SELECT coalesce(bool_and(s.n = a.n), true) AS whole_blocks
+  FROM (SELECT (ctid::text::point)[0] AS blk, count(*) AS n
+          FROM t_ztablesample TABLESAMPLE SYSTEM (50) REPEATABLE (0) GROUP BY 1) s
+  JOIN (SELECT (ctid::text::point)[0] AS blk, count(*) AS n
+          FROM t_ztablesample GROUP BY 1) a USING (blk);
+SELECT count(*) FROM t_ztablesample TABLESAMPLE SYSTEM (100);
+SELECT count(*) FROM t_ztablesample TABLESAMPLE SYSTEM (0);
 -- should return SOME visible tuples but from ALL the blocks
 SELECT ctid,id FROM t_ztablesample TABLESAMPLE BERNOULLI (50) REPEATABLE (0);
+-- a rescan must pick the same sample again
+SELECT count(DISTINCT c) AS same_sample
+  FROM (SELECT (SELECT count(*) FROM t_ztablesample TABLESAMPLE SYSTEM (50) REPEATABLE (0)
+                 WHERE id >= g - g) AS c
+          FROM generate_series(1, 3) g) x;
+
+--
+-- Speculative insertions (INSERT ... ON CONFLICT). The token of the last
+-- speculative insertion is normally cleared without looking up its TID
+-- again; check that insertions aborted by an error or a rollback don't
+-- confuse the next ones in the same backend.
+--
+create table t_zspec (a int primary key, b int unique, c text) using zedstore;
+insert into t_zspec values (1, 1, 'one'), (2, 2, 'two');
+insert into t_zspec values (1, 10, 'conflict'), (3, 3, 'three')
+  on conflict (a) do update set c = excluded.c;
+-- the speculative insertion fails on the other unique index
+insert into t_zspec values (4, 1, 'dup') on conflict (a) do nothing;
+insert into t_zspec values (4, 4, 'four') on conflict (a) do nothing;
+begin;
+insert into t_zspec values (5, 5, 'five') on conflict (a) do nothing;
+rollback;
+insert into t_zspec values (5, 5, 'five'), (2, 20, 'x') on conflict (a) do nothing;
+begin;
+savepoint s1;
+insert into t_zspec values (6, 2, 'dup') on conflict (a) do nothing;
+rollback to s1;
+insert into t_zspec values (6, 6, 'six') on conflict (a) do update set c = 'again';
+commit;
+select * from t_zspec order by a;
+drop table t_zspec;